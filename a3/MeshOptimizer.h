@@ -0,0 +1,58 @@
+/*  =================== File Information =================
+	File Name: MeshOptimizer.h
+	Description:
+	Author:
+
+	Purpose: Reorders the index and vertex arrays of a triangle mesh so the
+	         GPU does less work drawing it, and measures the result:
+	         1.) optimizeVertexCache: Forsyth's greedy triangle order, which
+	             keeps reusing vertices the post-transform cache still has
+	         2.) optimizeOverdraw: cuts that order into clusters and draws
+	             clusters facing outwards first, so fewer hidden pixels get
+	             shaded (Sander et al., "Fast Triangle Reordering")
+	         3.) optimizeVertexFetch: numbers the vertices in the order the
+	             triangles first use them, so vertex reads stream through memory
+	         simulateCache replays an index buffer through a FIFO cache of a
+	         given size on the CPU, so every step can be checked without a GPU.
+	Usage:	 run the steps in this order, each one expects the order the one
+	         before it made
+	===================================================== */
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <vector>
+
+class MeshOptimizer {
+public:
+	// entries of the simulated post-transform cache, a common size for GPUs with a FIFO cache
+	static const int SIMULATED_CACHE_SIZE = 16;
+
+	struct CacheStats {
+		int transformed;        // vertices the vertex shader has to run for
+		float acmr;             // average cache miss ratio: transformed vertices per triangle, 0.5 at best
+		float atvr;             // average transformed vertex ratio: per vertex the mesh uses, 1 at best
+	};
+
+	/*	Draws indexCount / 3 triangles through a FIFO cache of cacheSize vertices
+		and counts the misses. Indices are expected below vertexCount. */
+	static CacheStats simulateCache(const unsigned int* indices, int indexCount, int vertexCount, int cacheSize = SIMULATED_CACHE_SIZE);
+
+	// reorders the triangles in place, the vertices keep their numbers
+	static void optimizeVertexCache(unsigned int* indices, int indexCount, int vertexCount);
+
+	/*	Reorders clusters of the triangles in place. A cluster may only be split where
+		the cache miss ratio stays within threshold times what it was (1.05 gives up
+		at most 5%). positions holds x, y, z for every vertex. */
+	static void optimizeOverdraw(unsigned int* indices, int indexCount, const float* positions, int vertexCount, float threshold = 1.05f);
+
+	/*	Renumbers the vertices in order of first use, unused ones go last. positions
+		and normals (x, y, z per vertex, normals may be NULL) are permuted to match
+		and remap tells where every old vertex went. */
+	static void optimizeVertexFetch(unsigned int* indices, int indexCount, int vertexCount, float* positions, float* normals, std::vector<unsigned int>& remap);
+
+private:
+	// vertices Forsyth's scoring assumes the cache holds, its LRU model works well for FIFO caches too
+	static const int SCORING_CACHE_SIZE = 32;
+};
+
+#endif
@@ -223,7 +223,8 @@ void MyGLCanvas::reloadShaders() {
 
 void MyGLCanvas::loadPLY(std::string filename) {
 	delete myObjectPLY;
-	myObjectPLY = new ply(filename);
+	// files picked by the user can be large scans, worth reordering for the GPU
+	myObjectPLY = new ply(filename, true);
 	myObjectPLY->buildArrays();
 	myObjectPLY->bindVBO(myShaderManager->getShaderProgram("objectShaders")->programID);
 }
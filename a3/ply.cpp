@@ -8,17 +8,557 @@ Examples:
 ===================================================== */
 #define _CRT_SECURE_NO_WARNINGS
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <map>
+#include <memory>
 #include <fstream>
 #include <stdio.h>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <functional>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #include "ply.h"
 #include "geometry.h"
+#include "MeshOptimizer.h"
 #include <math.h>
 
 
 using namespace std;
 
+// ASCII bodies smaller than this aren't worth splitting up
+static const size_t MIN_CHUNK_BYTES = 1 << 18;
+
+// the scalar types of the PLY header, each under its old and its sized name
+enum PlyType { PLY_NONE, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+enum PlyFormat { PLY_ASCII, PLY_BINARY_LITTLE_ENDIAN, PLY_BINARY_BIG_ENDIAN };
+
+struct PlyProperty {
+	string name;
+	PlyType type;           // of the value, or of the entries of a list
+	PlyType countType;      // PLY_NONE unless the property is a list
+	int offset;             // bytes from the start of a binary record, -1 behind a list
+};
+
+// one element of the header, its records follow each other in the body
+struct PlyElement {
+	string name;
+	int count;
+	vector<PlyProperty> properties;
+	int stride;             // bytes of a binary record, -1 if the record has a list
+};
+
+static PlyType typeFromName(const string& name) {
+	if (name == "char" || name == "int8") return PLY_INT8;
+	if (name == "uchar" || name == "uint8") return PLY_UINT8;
+	if (name == "short" || name == "int16") return PLY_INT16;
+	if (name == "ushort" || name == "uint16") return PLY_UINT16;
+	if (name == "int" || name == "int32") return PLY_INT32;
+	if (name == "uint" || name == "uint32") return PLY_UINT32;
+	if (name == "float" || name == "float32") return PLY_FLOAT32;
+	if (name == "double" || name == "float64") return PLY_FLOAT64;
+	return PLY_NONE;
+}
+
+static int typeSize(PlyType type) {
+	switch (type) {
+	case PLY_INT8: case PLY_UINT8: return 1;
+	case PLY_INT16: case PLY_UINT16: return 2;
+	case PLY_INT32: case PLY_UINT32: case PLY_FLOAT32: return 4;
+	case PLY_FLOAT64: return 8;
+	default: return 0;
+	}
+}
+
+static bool hostIsLittleEndian() {
+	const unsigned short one = 1;
+	return *(const unsigned char*)&one == 1;
+}
+
+/*	The whole file, mapped read only where mmap exists and read into a new[] buffer
+	elsewhere. NULL if the file can't be read. */
+static char* loadFile(const string& fileName, size_t& size) {
+#ifdef _WIN32
+	ifstream file(fileName.c_str(), ios::in | ios::binary | ios::ate);
+	if (!file.is_open()) return NULL;
+	size = (size_t)file.tellg();
+	if (size == 0) return NULL;
+	char* data = new char[size];
+	file.seekg(0);
+	file.read(data, size);
+	return data;
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) return NULL;
+	char* data = NULL;
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size > 0) {
+		size = (size_t)info.st_size;
+		void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED) data = (char*)mapping;
+	}
+	close(fd);
+	return data;
+#endif
+}
+
+static void releaseFile(char* data, size_t size) {
+#ifdef _WIN32
+	delete[] data;
+#else
+	munmap(data, size);
+#endif
+}
+
+static inline const char* skipBlanks(const char* p, const char* end) {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+	return p;
+}
+
+// atoi without the locale, false (and p unmoved) if the line has no number left
+static inline bool parseInt(const char*& p, const char* end, int& value) {
+	const char* q = skipBlanks(p, end);
+	bool negative = q < end && *q == '-';
+	if (q < end && (*q == '-' || *q == '+')) q++;
+	unsigned int digit;
+	if (q >= end || (digit = (unsigned char)*q - '0') > 9) return false;
+	unsigned long long result = digit;
+	for (q++; q < end && (digit = (unsigned char)*q - '0') <= 9; q++) {
+		result = std::min(result * 10 + digit, 0x80000000ULL);
+	}
+	value = (int)std::min(result, 0x7fffffffULL) * (negative ? -1 : 1);
+	p = q;
+	return true;
+}
+
+/*	atof without the locale: the digits are gathered into an integer and scaled by an
+	exact power of ten. While both fit in a double this rounds only once, so the result
+	is the double strtod gives (Clinger's fast path). Longer mantissas, huge exponents,
+	inf and nan go through strtod. false if the line has no number left. */
+static inline bool parseFloat(const char*& p, const char* end, float& value) {
+	static const double POWERS[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const char* q = skipBlanks(p, end);
+	const char* token = q;
+	bool negative = q < end && *q == '-';
+	if (q < end && (*q == '-' || *q == '+')) q++;
+
+	// leading zeros add nothing, the digits after them have to fit in 19
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	const char* first = q;
+	unsigned int digit;
+	while (q < end && *q == '0') q++;
+	for (; q < end && (digit = (unsigned char)*q - '0') <= 9; q++, digits++) {
+		mantissa = mantissa * 10 + digit;
+	}
+	bool any = q > first;
+	if (q < end && *q == '.') {
+		const char* fraction = ++q;
+		if (digits == 0) {
+			while (q < end && *q == '0') q++;
+		}
+		for (; q < end && (digit = (unsigned char)*q - '0') <= 9; q++, digits++) {
+			mantissa = mantissa * 10 + digit;
+		}
+		exponent = -(int)(q - fraction);
+		any = any || q > fraction;
+	}
+	// an exponent only counts with digits right behind the e and its sign
+	if (any && q + 1 < end && (*q == 'e' || *q == 'E') && (q[1] == '-' || q[1] == '+' || (unsigned)((unsigned char)q[1] - '0') <= 9)) {
+		const char* e = q + 1;
+		int power;
+		if (parseInt(e, end, power)) {
+			exponent += std::max(-1000, std::min(power, 1000));
+			q = e;
+		}
+	}
+
+	if (any && digits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+		double result = (double)mantissa;
+		result = exponent < 0 ? result / POWERS[-exponent] : result * POWERS[exponent];
+		value = (float)(negative ? -result : result);
+		p = q;
+		return true;
+	}
+
+	// copied out because the mapped file has no terminating zero
+	char buffer[64];
+	size_t length = 0;
+	for (const char* c = token; c < end && length + 1 < sizeof(buffer) && *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n'; c++) {
+		buffer[length++] = *c;
+	}
+	buffer[length] = 0;
+	char* stop;
+	double result = strtod(buffer, &stop);
+	if (stop == buffer) return false;
+	value = (float)result;
+	p = token + (stop - buffer);
+	return true;
+}
+
+// task(0) to task(count - 1) spread over the cores, each thread takes the next one left
+static void runParallel(int count, const function<void(int)>& task) {
+	int threads = std::min(count, (int)std::max(1u, thread::hardware_concurrency()));
+	if (threads <= 1) {
+		for (int i = 0; i < count; i++) task(i);
+		return;
+	}
+	atomic<int> next(0);
+	vector<thread> workers;
+	for (int t = 0; t < threads; t++) {
+		workers.push_back(thread([&]() {
+			for (int i = next++; i < count; i = next++) task(i);
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+}
+
+// files next to the PLY files holding their final arrays, see readCache
+static const char* CACHE_SUFFIX = ".cache";
+static const char* OPTIMIZED_CACHE_SUFFIX = ".opt.cache";
+static const char CACHE_MAGIC[8] = { 'P', 'L', 'Y', 'C', 'A', 'C', 'H', 'E' };
+static const unsigned int CACHE_VERSION = 2;
+// reads back differently on a machine with the other byte order
+static const unsigned int CACHE_BYTE_ORDER = 0x01020304;
+
+/*	A cache is this header followed by vertexArray and normalsArray (vertexCount * 3
+	floats each) and indiciesArray (faceCount * 3 indices), all as the machine
+	holds them in memory. */
+struct CacheHeader {
+	char magic[8];
+	unsigned int version;
+	unsigned int byteOrder;
+	unsigned long long sourceHash;
+	unsigned long long sourceSize;
+	int vertexCount;
+	int faceCount;
+	int properties;
+};
+
+/*	FNV-1a taking eight bytes a step instead of one, so checking a file costs
+	about as much as copying it. Tells whether a cache or a loaded mesh came
+	from the same bytes. */
+static unsigned long long contentHash(const char* data, size_t size) {
+	unsigned long long hash = 14695981039346656037ULL;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		unsigned long long word;
+		memcpy(&word, data + i, 8);
+		hash ^= word;
+		hash *= 1099511628211ULL;
+	}
+	for (; i < size; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// the meshes in use by cache path, an entry expires with the last ply holding it
+static map<string, weak_ptr<plyMesh> > loadedMeshes;
+
+/*	Reads one value at p and moves p past it, false if the body ends first. ASCII
+	values are whitespace separated tokens, parsed without the locale; what a token
+	has behind its number is skipped. Binary ones are byte swapped when the file's
+	byte order isn't the machine's. */
+static inline bool readValue(const char*& p, const char* end, PlyType type, PlyFormat format, double& value) {
+	if (format == PLY_ASCII) {
+		while (p < end && (unsigned char)*p <= ' ') p++;
+		bool parsed;
+		if (type == PLY_FLOAT32 || type == PLY_FLOAT64) {
+			float number;
+			parsed = parseFloat(p, end, number);
+			value = number;
+		}
+		else {
+			int number;
+			parsed = parseInt(p, end, number);
+			value = number;
+		}
+		if (!parsed) return false;
+		while (p < end && (unsigned char)*p > ' ') p++;
+		return true;
+	}
+
+	int size = typeSize(type);
+	if (size == 0 || end - p < size) return false;
+	unsigned char bytes[8];
+	memcpy(bytes, p, size);
+	p += size;
+	if ((format == PLY_BINARY_LITTLE_ENDIAN) != hostIsLittleEndian()) {
+		reverse(bytes, bytes + size);
+	}
+	switch (type) {
+	case PLY_INT8: value = (signed char)bytes[0]; break;
+	case PLY_UINT8: value = bytes[0]; break;
+	case PLY_INT16: { short v; memcpy(&v, bytes, 2); value = v; break; }
+	case PLY_UINT16: { unsigned short v; memcpy(&v, bytes, 2); value = v; break; }
+	case PLY_INT32: { int v; memcpy(&v, bytes, 4); value = v; break; }
+	case PLY_UINT32: { unsigned int v; memcpy(&v, bytes, 4); value = v; break; }
+	case PLY_FLOAT32: { float v; memcpy(&v, bytes, 4); value = v; break; }
+	default: { double v; memcpy(&v, bytes, 8); value = v; break; }
+	}
+	return true;
+}
+
+// the entries of a list, or a scalar, read and thrown away
+static bool skipProperty(const char*& p, const char* end, const PlyProperty& property, PlyFormat format) {
+	double value;
+	if (property.countType == PLY_NONE) {
+		return readValue(p, end, property.type, format, value);
+	}
+	if (!readValue(p, end, property.countType, format, value) || value < 0) return false;
+	long long count = (long long)value;
+	if (format != PLY_ASCII) {
+		long long bytes = count * typeSize(property.type);
+		if (end - p < bytes) return false;
+		p += bytes;
+		return true;
+	}
+	for (long long i = 0; i < count; i++) {
+		if (!readValue(p, end, property.type, format, value)) return false;
+	}
+	return true;
+}
+
+// the header up to end_header, false if it isn't a PLY file this loader understands. body is set to the first data byte
+static bool parseHeader(const char* data, size_t size, PlyFormat& format, vector<PlyElement>& elements, size_t& body) {
+	size_t pos = 0;
+	bool first = true;
+	bool known = false;
+	while (pos < size) {
+		const char* lineEnd = (const char*)memchr(data + pos, '\n', size - pos);
+		size_t next = lineEnd != NULL ? lineEnd - data + 1 : size;
+		istringstream line(string(data + pos, next - pos));
+		pos = next;
+
+		string keyword;
+		line >> keyword;
+		if (first) {
+			if (keyword != "ply") return false;
+			first = false;
+		}
+		else if (keyword == "format") {
+			string name;
+			line >> name;
+			known = true;
+			if (name == "ascii") format = PLY_ASCII;
+			else if (name == "binary_little_endian") format = PLY_BINARY_LITTLE_ENDIAN;
+			else if (name == "binary_big_endian") format = PLY_BINARY_BIG_ENDIAN;
+			else known = false;
+		}
+		else if (keyword == "element") {
+			PlyElement element;
+			element.count = 0;
+			element.stride = 0;
+			line >> element.name >> element.count;
+			if (element.count < 0) return false;
+			elements.push_back(element);
+		}
+		else if (keyword == "property" && !elements.empty()) {
+			PlyElement& element = elements.back();
+			PlyProperty property;
+			string type;
+			line >> type;
+			property.countType = PLY_NONE;
+			if (type == "list") {
+				string countType;
+				line >> countType >> type;
+				property.countType = typeFromName(countType);
+				if (property.countType == PLY_NONE || property.countType == PLY_FLOAT32 || property.countType == PLY_FLOAT64) return false;
+			}
+			property.type = typeFromName(type);
+			if (property.type == PLY_NONE) return false;
+			line >> property.name;
+			property.offset = element.stride;
+			if (element.stride >= 0) {
+				element.stride = property.countType == PLY_NONE ? element.stride + typeSize(property.type) : -1;
+			}
+			element.properties.push_back(property);
+		}
+		else if (keyword == "end_header") {
+			body = pos;
+			return known;
+		}
+	}
+	return false;
+}
+
+// where a vertex property other than the position is kept in the vertex struct, NULL if nowhere
+static float vertex::* vertexField(const string& name) {
+	if (name == "nx") return &vertex::nx;
+	if (name == "ny") return &vertex::ny;
+	if (name == "nz") return &vertex::nz;
+	if (name == "red" || name == "r") return &vertex::r;
+	if (name == "green" || name == "g") return &vertex::g;
+	if (name == "blue" || name == "b") return &vertex::b;
+	if (name == "u" || name == "s" || name == "texture_u" || name == "texture_s") return &vertex::u;
+	if (name == "v" || name == "t" || name == "texture_v" || name == "texture_t") return &vertex::v;
+	if (name == "confidence") return &vertex::confidence;
+	if (name == "intensity") return &vertex::intensity;
+	return NULL;
+}
+
+/*	Reads vertices first to first + count. Positions go to positions, three floats a
+	vertex. attributes, unless it is NULL, gets the normals, colours, texture
+	coordinates, confidence and intensity the file has; 8 bit colours are scaled
+	to [0, 1]. */
+static bool readVertices(const char*& p, const char* end, const PlyElement& element, PlyFormat format, int first, int count,
+	GLfloat* positions, vertex* attributes) {
+	const vector<PlyProperty>& properties = element.properties;
+	vector<int> axes(properties.size(), -1);
+	vector<float vertex::*> fields(properties.size(), (float vertex::*)NULL);
+	vector<float> scales(properties.size(), 1.0f);
+	int xProperty = -1;
+	for (size_t k = 0; k < properties.size(); k++) {
+		const string& name = properties[k].name;
+		if (name == "x") { axes[k] = 0; xProperty = (int)k; }
+		else if (name == "y") axes[k] = 1;
+		else if (name == "z") axes[k] = 2;
+		else if (attributes != NULL) fields[k] = vertexField(name);
+		if (properties[k].type == PLY_UINT8) scales[k] = 1.0f / 255.0f;
+	}
+
+	// x, y and z stored as three floats in a row in the machine's byte order are copied as they are
+	PlyFormat hostFormat = hostIsLittleEndian() ? PLY_BINARY_LITTLE_ENDIAN : PLY_BINARY_BIG_ENDIAN;
+	bool direct = format == hostFormat && element.stride > 0 && xProperty >= 0 && xProperty + 2 < (int)properties.size();
+	for (int axis = 0; direct && axis < 3; axis++) {
+		const PlyProperty& property = properties[xProperty + axis];
+		direct = axes[xProperty + axis] == axis && property.type == PLY_FLOAT32 && property.countType == PLY_NONE;
+	}
+	if (direct) {
+		size_t stride = element.stride;
+		size_t bytes = (size_t)count * stride;
+		if ((size_t)(end - p) < bytes) return false;
+		if (stride == 3 * sizeof(GLfloat)) {
+			memcpy(positions + (size_t)first * 3, p, bytes);
+		}
+		else {
+			const char* position = p + properties[xProperty].offset;
+			for (int i = 0; i < count; i++) {
+				memcpy(positions + (size_t)(first + i) * 3, position + i * stride, 3 * sizeof(GLfloat));
+			}
+		}
+		if (attributes == NULL) {
+			p += bytes;
+			return true;
+		}
+	}
+
+	for (int i = first; i < first + count; i++) {
+		for (size_t k = 0; k < properties.size(); k++) {
+			const PlyProperty& property = properties[k];
+			if (property.countType != PLY_NONE) {
+				if (!skipProperty(p, end, property, format)) return false;
+				continue;
+			}
+			double value;
+			if (!readValue(p, end, property.type, format, value)) return false;
+			if (axes[k] >= 0) {
+				if (!direct) positions[i * 3 + axes[k]] = (GLfloat)value;
+			}
+			else if (fields[k] != NULL) {
+				attributes[i].*fields[k] = (float)value * scales[k];
+			}
+		}
+	}
+	return true;
+}
+
+/*	Reads faces first to first + count: the vertex index list goes to faces, other
+	face properties are skipped. Faces with fewer than three corners or corners
+	outside the vertexCount vertices make the file broken, buildArrays indexes
+	with them. */
+static bool readFaces(const char*& p, const char* end, const PlyElement& element, PlyFormat format, int first, int count,
+	int vertexCount, face* faces) {
+	const vector<PlyProperty>& properties = element.properties;
+	int indexList = -1;
+	for (size_t k = 0; k < properties.size() && indexList < 0; k++) {
+		if (properties[k].countType != PLY_NONE && (properties[k].name == "vertex_indices" || properties[k].name == "vertex_index")) indexList = (int)k;
+	}
+	for (size_t k = 0; k < properties.size() && indexList < 0; k++) {
+		if (properties[k].countType != PLY_NONE) indexList = (int)k;
+	}
+	if (indexList < 0) return false;
+
+	// 32 bit indices in the machine's byte order are copied as they are
+	PlyFormat hostFormat = hostIsLittleEndian() ? PLY_BINARY_LITTLE_ENDIAN : PLY_BINARY_BIG_ENDIAN;
+	PlyType indexType = properties[indexList].type;
+	bool direct = format == hostFormat && (indexType == PLY_INT32 || indexType == PLY_UINT32);
+
+	for (int i = first; i < first + count; i++) {
+		for (size_t k = 0; k < properties.size(); k++) {
+			const PlyProperty& property = properties[k];
+			if ((int)k != indexList) {
+				if (!skipProperty(p, end, property, format)) return false;
+				continue;
+			}
+			// every index takes at least a byte, a larger count can only be a broken file
+			double value;
+			if (!readValue(p, end, property.countType, format, value) || value < 3 || value > (double)(end - p)) return false;
+			int corners = (int)value;
+			faces[i].vertexCount = corners;
+			faces[i].vertexList = new int[corners];
+			if (direct) {
+				if ((size_t)(end - p) < corners * sizeof(int)) return false;
+				memcpy(faces[i].vertexList, p, corners * sizeof(int));
+				p += corners * sizeof(int);
+			}
+			else {
+				for (int j = 0; j < corners; j++) {
+					if (!readValue(p, end, property.type, format, value)) return false;
+					faces[i].vertexList[j] = (int)value;
+				}
+			}
+			for (int j = 0; j < corners; j++) {
+				if (faces[i].vertexList[j] < 0 || faces[i].vertexList[j] >= vertexCount) return false;
+			}
+		}
+	}
+	return true;
+}
+
+plyMesh::plyMesh() {
+	vertexCount = 0;
+	faceCount = 0;
+	properties = 0;
+	vertexArray = NULL;
+	indiciesArray = NULL;
+	normalsArray = NULL;
+	vertexVBO_id = -1;
+	indicesVBO_id = -1;
+	normalVBO_id = -1;
+	sourceHash = 0;
+	sourceSize = 0;
+}
+
+// the last ply using the mesh is gone, so are its arrays and buffers
+plyMesh::~plyMesh() {
+	delete[] vertexArray;
+	delete[] indiciesArray;
+	delete[] normalsArray;
+	if (vertexVBO_id != -1)
+		glDeleteBuffers(1, &vertexVBO_id);
+	if (indicesVBO_id != -1)
+		glDeleteBuffers(1, &indicesVBO_id);
+	if (normalVBO_id != -1)
+		glDeleteBuffers(1, &normalVBO_id);
+}
+
 /*  ===============================================
 Desc: Default constructor for a ply object
 Precondition:
@@ -27,19 +567,11 @@ Postcondition:
 ply::ply() {
 	vertexList = NULL;
 	faceList = NULL;
-	vertexArray = NULL;
-    indiciesArray = NULL;
-    normalsArray = NULL;
 	properties = 0;
 	faceCount = 0;
 	vertexCount = 0;
+	optimize = false;
 	vao = -1;
-	vertexVBO_id = -1;
-	indicesVBO_id = -1;
-	normalVBO_id = -1;
-	vertexArray = NULL;
-	indiciesArray = NULL;
-	normalsArray = NULL;
 }
 
 /*  ===============================================
@@ -47,23 +579,14 @@ Desc: constructor for a ply object with a default path
 Precondition:
 Postcondition:
 =============================================== */
-ply::ply(string filePath) {
+ply::ply(string filePath, bool optimize) {
 	vertexList = NULL;
 	faceList = NULL;
-	vertexArray = NULL;
-	indiciesArray = NULL;
-	normalsArray = NULL;
 	faceCount = 0;
 	vertexCount = 0;
 	properties = 0;
 	vao = -1;
-	vertexVBO_id = -1;
-	indicesVBO_id = -1;
-	normalVBO_id = -1;
-	vertexList = NULL;
-	faceList = NULL;
-	vertexArray = NULL;
-	reload(filePath);
+	reload(filePath, optimize);
 }
 
 
@@ -81,7 +604,7 @@ void ply::reset() {
 	if (vertexList != NULL)
 		delete[] vertexList;
 
-	for (int i = 0; i < faceCount; i++) {
+	for (int i = 0; faceList != NULL && i < faceCount; i++) {
 		delete[] faceList[i].vertexList;
 	}
 
@@ -90,35 +613,14 @@ void ply::reset() {
 	// Set pointers to NULL
 	vertexList = NULL;
 	faceList = NULL;
+	vertexCount = 0;
+	faceCount = 0;
 
-
-	if (vertexArray != NULL) {
-		delete[] vertexArray;
-		vertexArray = NULL;
-	}
-
-	if (indiciesArray != NULL) {
-		delete[] indiciesArray;
-		indiciesArray = NULL;
-	}
-
-	if (normalsArray != NULL) {
-		delete[] normalsArray;
-		normalsArray = NULL;
-	}
-
-	// Destroy our vertex buffer object
-	if (vertexVBO_id != -1)
-		glDeleteBuffers(1, &vertexVBO_id);
-	if (indicesVBO_id != -1)
-		glDeleteBuffers(1, &indicesVBO_id);
-	if (normalVBO_id != -1)
-		glDeleteBuffers(1, &normalVBO_id);
-
+	// the arrays and buffers go with the last ply sharing them
+	mesh.reset();
+	if (vao != -1)
+		glDeleteVertexArrays(1, &vao);
 	vao = -1;
-	vertexVBO_id = -1;
-	indicesVBO_id = -1;
-	normalVBO_id = -1;
 }
 
 
@@ -127,8 +629,9 @@ Desc: reloads the geometry for a 3D object
 Precondition:
 Postcondition:
 =============================================== */
-void ply::reload(string _filePath) {
+void ply::reload(string _filePath, bool _optimize) {
 	filePath = _filePath;
+	optimize = _optimize;
 	reset();
 
 	// Call our function again to load new vertex and face information.
@@ -136,110 +639,277 @@ void ply::reload(string _filePath) {
 }
 
 /*  ===============================================
-Desc: You get to implement this
+Desc: Gets the final arrays the quickest way there is
+	1.) Another ply has this file loaded: share its mesh
+	2.) An earlier run left a cache of this file: copy the arrays out of it
+	3.) Parse the file, build the arrays and write the cache
+	Both caches only count for a file of the same size and content hash, and
+	hold optimized and plain meshes apart.
 Precondition:
 Postcondition:
 =============================================== */
 void ply::loadGeometry() {
+	size_t size = 0;
+	char* data = loadFile(filePath, size);
+	if (data == NULL) {
+		cout << "cannot open file " << filePath.c_str() << "\n";
+		return;
+	}
+	unsigned long long hash = contentHash(data, size);
+
+	shared_ptr<plyMesh> loaded = loadedMeshes[cachePath()].lock();
+	if (loaded && loaded->sourceHash == hash && loaded->sourceSize == size) {
+		releaseFile(data, size);
+		mesh = loaded;
+		vertexCount = mesh->vertexCount;
+		faceCount = mesh->faceCount;
+		properties = mesh->properties;
+		cout << "completed loading: " << filePath.c_str() << " (already loaded)\n";
+		return;
+	}
 
-	/* You will implement this section of code
-	1. Parse the header
-	2.) Update any private or helper variables in the ply.h private section
-	3.) allocate memory for the vertexList
-	3a.) Populate vertices
-	4.) allocate memory for the faceList
-	4a.) Populate faceList
-	*/
-
-
-	ifstream myfile(filePath.c_str()); // load the file
-	if (myfile.is_open()) { // if the file is accessable
-		properties = -2; // set the properties because there are extras labeled
-
-		string line;
-		char* token_pointer;
-		char* lineCopy = new char[256];
-		int count;
-		bool reading_header = true;
-		// loop for reading the header 
-		while (reading_header && getline(myfile, line)) {
-
-			// get the first token in the line, this will determine which
-			// action to take. 
-			strcpy(lineCopy, line.c_str());
-			token_pointer = strtok(lineCopy, " \r");
-			// case when the element label is spotted:
-			if (strcmp(token_pointer, "element") == 0) {
-				token_pointer = strtok(NULL, " \r");
-
-				// When the vertex token is spotted read in the next token
-				// and use it to set the vertexCount and initialize vertexList
-				if (strcmp(token_pointer, "vertex") == 0) {
-					token_pointer = strtok(NULL, "  \r");
-					vertexCount = atoi(token_pointer);
-					vertexList = new vertex[vertexCount];
-				}
+	mesh = make_shared<plyMesh>();
+	mesh->sourceHash = hash;
+	mesh->sourceSize = size;
+	if (readCache()) {
+		releaseFile(data, size);
+		vertexCount = mesh->vertexCount;
+		faceCount = mesh->faceCount;
+		properties = mesh->properties;
+		loadedMeshes[cachePath()] = mesh;
+		cout << "completed loading: " << filePath.c_str() << " (cached)\n";
+		return;
+	}
 
-				// When the face label is spotted read in the next token and 
-				// use it to set the faceCount and initialize faceList.
-				if (strcmp(token_pointer, "face") == 0) {
-					token_pointer = strtok(NULL, "  \r");
-					faceCount = atoi(token_pointer);
-					faceList = new face[faceCount];
-				}
-			}
-			// if property label increment the number of properties.
-			if (strcmp(token_pointer, "property") == 0) { properties++; }
-			// if end_header break the header loop and move to reading vertices.
-			if (strcmp(token_pointer, "end_header") == 0) { reading_header = false; }
-		}
+	bool parsed = parseGeometry(data, size);
+	releaseFile(data, size);
+	if (!parsed) {
+		reset();
+		return;
+	}
+	buildArrays();
+	writeCache();
+	loadedMeshes[cachePath()] = mesh;
+	cout << "completed loading: " << filePath.c_str() << "\n";
+}
 
-		// Read in exactly vertexCount number of lines after reading the header
-		// and set the appropriate vertex in the vertexList.
-		for (int i = 0; i < vertexCount; i++) {
+/*  ===============================================
+Desc: Fills mesh from the cache an earlier run wrote for filePath
+Precondition: mesh has the hash and size of the file
+Postcondition: false if there is no cache, or it belongs to other bytes
+=============================================== */
+bool ply::readCache() {
+	size_t size = 0;
+	char* data = loadFile(cachePath(), size);
+	if (data == NULL) {
+		return false;
+	}
+	CacheHeader header;
+	bool valid = size >= sizeof(header);
+	if (valid) {
+		memcpy(&header, data, sizeof(header));
+		valid = memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && header.version == CACHE_VERSION && header.byteOrder == CACHE_BYTE_ORDER
+			&& header.sourceHash == mesh->sourceHash && header.sourceSize == mesh->sourceSize && header.vertexCount >= 0 && header.faceCount >= 0
+			&& size == sizeof(header) + (size_t)header.vertexCount * 6 * sizeof(GLfloat) + (size_t)header.faceCount * 3 * sizeof(GLuint);
+	}
+	if (valid) {
+		const char* p = data + sizeof(header);
+		size_t floats = (size_t)header.vertexCount * 3;
+		size_t indices = (size_t)header.faceCount * 3;
+		mesh->vertexCount = header.vertexCount;
+		mesh->faceCount = header.faceCount;
+		mesh->properties = header.properties;
+		mesh->vertexArray = new GLfloat[floats];
+		mesh->normalsArray = new GLfloat[floats];
+		mesh->indiciesArray = new GLuint[indices];
+		memcpy(mesh->vertexArray, p, floats * sizeof(GLfloat));
+		p += floats * sizeof(GLfloat);
+		memcpy(mesh->normalsArray, p, floats * sizeof(GLfloat));
+		p += floats * sizeof(GLfloat);
+		memcpy(mesh->indiciesArray, p, indices * sizeof(GLuint));
+	}
+	releaseFile(data, size);
+	return valid;
+}
+
+/*  ===============================================
+Desc: Writes the arrays of mesh next to filePath for the next run. If the
+	folder can't be written to, the next run parses the file again.
+Precondition: buildArrays has run
+Postcondition:
+=============================================== */
+void ply::writeCache() {
+	if (mesh == NULL || mesh->indiciesArray == NULL) {
+		return;
+	}
+	CacheHeader header;
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.byteOrder = CACHE_BYTE_ORDER;
+	header.sourceHash = mesh->sourceHash;
+	header.sourceSize = mesh->sourceSize;
+	header.vertexCount = mesh->vertexCount;
+	header.faceCount = mesh->faceCount;
+	header.properties = mesh->properties;
+
+	ofstream file(cachePath().c_str(), ios::out | ios::binary | ios::trunc);
+	if (!file.is_open()) {
+		return;
+	}
+	size_t floats = (size_t)mesh->vertexCount * 3;
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)mesh->vertexArray, floats * sizeof(GLfloat));
+	file.write((const char*)mesh->normalsArray, floats * sizeof(GLfloat));
+	file.write((const char*)mesh->indiciesArray, (size_t)mesh->faceCount * 3 * sizeof(GLuint));
+}
 
-			getline(myfile, line);
-			strcpy(lineCopy, line.c_str());
+// where the cache of this file goes, optimized meshes have their own
+string ply::cachePath() {
+	return filePath + (optimize ? OPTIMIZED_CACHE_SUFFIX : CACHE_SUFFIX);
+}
 
-			// by convention the first three are x, y, z and we ignore the rest
-			if (properties >= 0) {
-				vertexList[i].x = atof(strtok(lineCopy, " \r"));
-			}
-			if (properties >= 1) {
-				vertexList[i].y = atof(strtok(NULL, " \r"));
+/*  ===============================================
+Desc: Parses ASCII and binary files of either byte order
+	1.) Parse the header, which gives every property a type
+	2.) Read the elements in the order of the header: positions go straight
+		to vertexArray, the other vertex properties to vertexList when the
+		file has any, and index lists to faceList. Other elements are skipped.
+	Binary files with x, y and z as consecutive floats in the machine's byte
+	order are copied into vertexArray without looking at each value.
+	ASCII bodies are cut into chunks at line ends and parsed on all cores.
+	Counting the lines of each chunk first tells every chunk which records
+	it holds, one record a line.
+Precondition: mesh is new
+Postcondition: false if the file is broken
+=============================================== */
+bool ply::parseGeometry(const char* data, size_t size) {
+	PlyFormat format = PLY_ASCII;
+	vector<PlyElement> elements;
+	size_t bodyStart = 0;
+	if (!parseHeader(data, size, format, elements, bodyStart)) {
+		cout << "cannot parse the header of " << filePath.c_str() << "\n";
+		return false;
+	}
+
+	int vertexElement = -1, faceElement = -1;
+	bool attributes = false;
+	for (size_t e = 0; e < elements.size(); e++) {
+		const PlyElement& element = elements[e];
+		if (element.name == "vertex" && vertexElement < 0) {
+			vertexElement = (int)e;
+			for (size_t k = 0; k < element.properties.size(); k++) {
+				if (vertexField(element.properties[k].name) != NULL) attributes = true;
 			}
-			if (properties >= 2) {
-				vertexList[i].z = atof(strtok(NULL, " \r"));
+		}
+		for (size_t k = 0; k < element.properties.size(); k++) {
+			if (element.name == "face" && faceElement < 0 && element.properties[k].countType != PLY_NONE) faceElement = (int)e;
+		}
+	}
+	vertexCount = vertexElement >= 0 ? elements[vertexElement].count : 0;
+	faceCount = faceElement >= 0 ? elements[faceElement].count : 0;
+	properties = vertexElement >= 0 ? (int)elements[vertexElement].properties.size() : 0;
+	mesh->vertexArray = new GLfloat[vertexCount * 3]();
+	vertexList = attributes ? new vertex[vertexCount]() : NULL;
+	faceList = new face[faceCount];
+
+	// records first to first + count of element e, false if they are broken or cut off
+	auto readRecords = [&](const char*& p, const char* end, int e, int first, int count) {
+		const PlyElement& element = elements[e];
+		if (e == vertexElement) {
+			return readVertices(p, end, element, format, first, count, mesh->vertexArray, vertexList);
+		}
+		if (e == faceElement) {
+			return readFaces(p, end, element, format, first, count, vertexCount, faceList);
+		}
+		if (format != PLY_ASCII && element.stride >= 0) {
+			size_t bytes = (size_t)count * element.stride;
+			if ((size_t)(end - p) < bytes) return false;
+			p += bytes;
+			return true;
+		}
+		for (int i = 0; i < count; i++) {
+			for (size_t k = 0; k < element.properties.size(); k++) {
+				if (!skipProperty(p, end, element.properties[k], format)) return false;
 			}
 		}
+		return true;
+	};
+
+	const char* body = data + bodyStart;
+	const char* end = data + size;
+	bool complete = true;
+	if (format != PLY_ASCII) {
+		const char* p = body;
+		for (size_t e = 0; e < elements.size() && complete; e++) {
+			complete = readRecords(p, end, (int)e, 0, elements[e].count);
+		}
+	}
+	else {
+		// the line each element starts on
+		vector<long long> elementStarts(elements.size() + 1, 0);
+		for (size_t e = 0; e < elements.size(); e++) {
+			elementStarts[e + 1] = elementStarts[e] + elements[e].count;
+		}
 
-		// Read in the faces (exactly faceCount number of lines) and set the 
-		// appropriate face in the faceList
-		for (int i = 0; i < faceCount; i++) {
-
-			getline(myfile, line);
-
-			strcpy(lineCopy, line.c_str());
-			count = atoi(strtok(lineCopy, " \r"));
-			faceList[i].vertexCount = count; // number of vertices stored 
-			faceList[i].vertexList = new int[count]; // initialize the vertices
+		// chunk boundaries moved forward to just after a line end
+		size_t bodySize = end - body;
+		int chunkCount = (int)std::max((size_t)1, std::min((size_t)std::max(1u, thread::hardware_concurrency()) * 4, bodySize / MIN_CHUNK_BYTES));
+		vector<const char*> chunkStarts(chunkCount + 1, end);
+		chunkStarts[0] = body;
+		for (int c = 1; c < chunkCount; c++) {
+			const char* split = body + bodySize / chunkCount * c;
+			const char* lineEnd = (const char*)memchr(split, '\n', end - split);
+			chunkStarts[c] = lineEnd != NULL ? lineEnd + 1 : end;
+		}
 
-			// set the vertices from the input, reading only the number of 
-			// vertices that are specified
-			for (int j = 0; j < count; j++) {
-				faceList[i].vertexList[j] = atoi(strtok(NULL, " \r"));
+		// a chunk's last line counts even without a line end, only the file's last one can lack it
+		vector<long long> chunkLines(chunkCount + 1, 0);
+		runParallel(chunkCount, [&](int c) {
+			const char* first = chunkStarts[c];
+			const char* last = std::max(first, chunkStarts[c + 1]);
+			long long lines = std::count(first, last, '\n');
+			if (last > first && last[-1] != '\n') lines++;
+			chunkLines[c + 1] = lines;
+		});
+		for (int c = 0; c < chunkCount; c++) {
+			chunkLines[c + 1] += chunkLines[c];
+		}
+		complete = chunkLines[chunkCount] >= elementStarts[elements.size()];
+
+		// each chunk reads the records on its lines and must have nothing but blanks left
+		vector<char> chunkComplete(chunkCount, 1);
+		runParallel(complete ? chunkCount : 0, [&](int c) {
+			const char* p = chunkStarts[c];
+			const char* chunkEnd = std::max(p, chunkStarts[c + 1]);
+			bool ok = true;
+			for (size_t e = 0; e < elements.size() && ok; e++) {
+				long long first = std::max(elementStarts[e], chunkLines[c]);
+				long long last = std::min(elementStarts[e + 1], chunkLines[c + 1]);
+				if (first < last) {
+					ok = readRecords(p, chunkEnd, (int)e, (int)(first - elementStarts[e]), (int)(last - first));
+				}
 			}
+			while (ok && p < chunkEnd && (unsigned char)*p <= ' ') p++;
+			chunkComplete[c] = ok && p == chunkEnd;
+		});
+		for (int c = 0; c < chunkCount; c++) {
+			complete = complete && chunkComplete[c];
 		}
-		delete(lineCopy);
-		myfile.close();
-		scaleAndCenter();
-		cout << "completed loading: " << filePath.c_str() << "\n";
 	}
-	// if the path is invalid, report then exit.
-	else {
-		cout << "cannot open file " << filePath.c_str() << "\n";
+	if (!complete) {
+		cout << "broken or incomplete data in " << filePath.c_str() << "\n";
+		return false;
 	}
-};
+
+	if (vertexCount > 0) scaleAndCenter();
+	// the vertex structs are complete once they have the final positions too
+	for (int i = 0; vertexList != NULL && i < vertexCount; i++) {
+		vertexList[i].x = mesh->vertexArray[i * 3 + 0];
+		vertexList[i].y = mesh->vertexArray[i * 3 + 1];
+		vertexList[i].z = mesh->vertexArray[i * 3 + 2];
+	}
+	return true;
+}
 
 /*  ===============================================
 Desc: Moves all the geometry so that the object is centered at 0, 0, 0 and scaled to be between 0.5 and -0.5
@@ -257,9 +927,9 @@ void ply::scaleAndCenter() {
 	for (i = 0; i < vertexCount; i++) {
 
 		// obtain the total for each property of the vertex
-		avrg_x += vertexList[i].x;
-		avrg_y += vertexList[i].y;
-		avrg_z += vertexList[i].z;
+		avrg_x += mesh->vertexArray[i * 3 + 0];
+		avrg_y += mesh->vertexArray[i * 3 + 1];
+		avrg_z += mesh->vertexArray[i * 3 + 2];
 	}
 
 	// compute the average for each property
@@ -269,17 +939,17 @@ void ply::scaleAndCenter() {
 
 	// center each vertex
 	for (i = 0; i < vertexCount; i++) {
-		vertexList[i].x = (vertexList[i].x - avrg_x);
-		vertexList[i].y = (vertexList[i].y - avrg_y);
-		vertexList[i].z = (vertexList[i].z - avrg_z);
+		mesh->vertexArray[i * 3 + 0] = (mesh->vertexArray[i * 3 + 0] - avrg_x);
+		mesh->vertexArray[i * 3 + 1] = (mesh->vertexArray[i * 3 + 1] - avrg_y);
+		mesh->vertexArray[i * 3 + 2] = (mesh->vertexArray[i * 3 + 2] - avrg_z);
 	}
 
 	// find the range of the vertices
 	for (i = 0; i < vertexCount; i++) {
 		// obtain the max dimension to find the furthest point from 0,0
-		if (max < fabs(vertexList[i].x)) max = fabs(vertexList[i].x);
-		if (max < fabs(vertexList[i].y)) max = fabs(vertexList[i].y);
-		if (max < fabs(vertexList[i].z)) max = fabs(vertexList[i].z);
+		if (max < fabs(mesh->vertexArray[i * 3 + 0])) max = fabs(mesh->vertexArray[i * 3 + 0]);
+		if (max < fabs(mesh->vertexArray[i * 3 + 1])) max = fabs(mesh->vertexArray[i * 3 + 1]);
+		if (max < fabs(mesh->vertexArray[i * 3 + 2])) max = fabs(mesh->vertexArray[i * 3 + 2]);
 	}
 
 	// max is doubled so that the range we get is from 0.5 to -0.5
@@ -287,9 +957,9 @@ void ply::scaleAndCenter() {
 
 	// scale each vertex to fit within the bounds
 	for (i = 0; i < vertexCount; i++) {
-		vertexList[i].x = vertexList[i].x / max;
-		vertexList[i].y = vertexList[i].y / max;
-		vertexList[i].z = vertexList[i].z / max;
+		mesh->vertexArray[i * 3 + 0] = mesh->vertexArray[i * 3 + 0] / max;
+		mesh->vertexArray[i * 3 + 1] = mesh->vertexArray[i * 3 + 1] / max;
+		mesh->vertexArray[i * 3 + 2] = mesh->vertexArray[i * 3 + 2] / max;
 	}
 }
 
@@ -359,12 +1029,12 @@ Precondition:
 Postcondition:
 =============================================== */
 void ply::printVertexList() {
-	if (vertexList == NULL) {
+	if (mesh == NULL || mesh->vertexArray == NULL) {
 		return;
 	}
 	else {
 		for (int i = 0; i < vertexCount; i++) {
-			cout << vertexList[i].x << "," << vertexList[i].y << "," << vertexList[i].z << endl;
+			cout << mesh->vertexArray[i * 3 + 0] << "," << mesh->vertexArray[i * 3 + 1] << "," << mesh->vertexArray[i * 3 + 2] << endl;
 		}
 	}
 }
@@ -376,7 +1046,7 @@ Precondition:
 Postcondition:
 =============================================== */
 void ply::printFaceList() {
-	if (faceList == NULL) {
+	if (faceList == NULL || mesh == NULL) {
 		return;
 	}
 	else {
@@ -386,7 +1056,7 @@ void ply::printFaceList() {
 			for (int j = 0; j < faceList[i].vertexCount; j++) {
 				// Print out the vertex
 				int index = faceList[i].vertexList[j];
-				cout << vertexList[index].x << "," << vertexList[index].y << "," << vertexList[index].z << endl;
+				cout << mesh->vertexArray[index * 3 + 0] << "," << mesh->vertexArray[index * 3 + 1] << "," << mesh->vertexArray[index * 3 + 2] << endl;
 			}
 		}
 	}
@@ -481,26 +1151,29 @@ void ply::computeNormal(float x1, float y1, float z1,
   Postcondition:
 =============================================== */
 void ply::buildArrays() {
-	// allocate memory for our arrays
-	vertexArray = new GLfloat[vertexCount * 3];
-	if (vertexArray == NULL) {
-		cout << "Ran out of memory(vertexArray)!" << endl;
+	// the loader has already put the positions in vertexArray. Cached and
+	// shared meshes come with the other arrays too
+	if (mesh == NULL || mesh->vertexArray == NULL || mesh->indiciesArray != NULL) {
 		return;
 	}
+	mesh->vertexCount = vertexCount;
+	mesh->faceCount = faceCount;
+	mesh->properties = properties;
 
-	indiciesArray = new GLuint[faceCount * 3];
-	if (indiciesArray == NULL) {
+	// allocate memory for our arrays
+	mesh->indiciesArray = new GLuint[faceCount * 3];
+	if (mesh->indiciesArray == NULL) {
 		cout << "Ran out of memory(indiciesArray)!" << endl;
 		return;
 	}
 
-	normalsArray = new GLfloat[vertexCount * 3];
-	if (normalsArray == NULL) {
+	mesh->normalsArray = new GLfloat[vertexCount * 3];
+	if (mesh->normalsArray == NULL) {
 		cout << "Ran out of memory(normalsArray)!" << endl;
 		return;
 	}
 	for (int i = 0; i < vertexCount * 3; i++) {
-		normalsArray[i] = 0.0;
+		mesh->normalsArray[i] = 0.0;
 	}
 
 	int* numNormals = new int[vertexCount];
@@ -513,18 +1186,6 @@ void ply::buildArrays() {
 	}
 
 
-	// Compress all of the vertices into a simple array
-	if (vertexList == NULL) {
-		return;
-	}
-	else {
-		for (int i = 0; i < vertexCount; i++) {
-			vertexArray[i * 3 + 0] = vertexList[i].x;
-			vertexArray[i * 3 + 1] = vertexList[i].y;
-			vertexArray[i * 3 + 2] = vertexList[i].z;
-		}
-	}
-
 	// Compress everything into one array of indices
 	unsigned int k = 0;
 	if (faceList == NULL) {
@@ -538,9 +1199,9 @@ void ply::buildArrays() {
 			int index1 = faceList[i].vertexList[1];
 			int index2 = faceList[i].vertexList[2];
 
-			indiciesArray[k] = index0;
-			indiciesArray[k + 1] = index1;
-			indiciesArray[k + 2] = index2;
+			mesh->indiciesArray[k] = index0;
+			mesh->indiciesArray[k + 1] = index1;
+			mesh->indiciesArray[k + 2] = index2;
 
 			k += 3;
 		}
@@ -557,71 +1218,124 @@ void ply::buildArrays() {
 	//  1. we sum up all the normals. 
 	//  2. While we are doing that, we need to keep a counter for the number of normals at a vertex
 	for (int i = 0; i < faceCount * 3; i = i + 3) {
-		int index0 = indiciesArray[i];
-		int index1 = indiciesArray[i + 1];
-		int index2 = indiciesArray[i + 2];
+		int index0 = mesh->indiciesArray[i];
+		int index1 = mesh->indiciesArray[i + 1];
+		int index2 = mesh->indiciesArray[i + 2];
 
 		float outputx, outputy, outputz;
 		// using the setNormal function from below we normalize the vectors
 		computeNormal(
-			vertexArray[index0 * 3 + 0], vertexArray[index0 * 3 + 1], vertexArray[index0 * 3 + 2],
-			vertexArray[index1 * 3 + 0], vertexArray[index1 * 3 + 1], vertexArray[index1 * 3 + 2],
-			vertexArray[index2 * 3 + 0], vertexArray[index2 * 3 + 1], vertexArray[index2 * 3 + 2],
+			mesh->vertexArray[index0 * 3 + 0], mesh->vertexArray[index0 * 3 + 1], mesh->vertexArray[index0 * 3 + 2],
+			mesh->vertexArray[index1 * 3 + 0], mesh->vertexArray[index1 * 3 + 1], mesh->vertexArray[index1 * 3 + 2],
+			mesh->vertexArray[index2 * 3 + 0], mesh->vertexArray[index2 * 3 + 1], mesh->vertexArray[index2 * 3 + 2],
 			&outputx, &outputy, &outputz);
 
 		numNormals[index0]++;
 		numNormals[index1]++;
 		numNormals[index2]++;
 
-		normalsArray[index0 * 3 + 0] += outputx;
-		normalsArray[index0 * 3 + 1] += outputy;
-		normalsArray[index0 * 3 + 2] += outputz;
+		mesh->normalsArray[index0 * 3 + 0] += outputx;
+		mesh->normalsArray[index0 * 3 + 1] += outputy;
+		mesh->normalsArray[index0 * 3 + 2] += outputz;
 
-		normalsArray[index1 * 3 + 0] += outputx;
-		normalsArray[index1 * 3 + 1] += outputy;
-		normalsArray[index1 * 3 + 2] += outputz;
+		mesh->normalsArray[index1 * 3 + 0] += outputx;
+		mesh->normalsArray[index1 * 3 + 1] += outputy;
+		mesh->normalsArray[index1 * 3 + 2] += outputz;
 
-		normalsArray[index2 * 3 + 0] += outputx;
-		normalsArray[index2 * 3 + 1] += outputy;
-		normalsArray[index2 * 3 + 2] += outputz;
+		mesh->normalsArray[index2 * 3 + 0] += outputx;
+		mesh->normalsArray[index2 * 3 + 1] += outputy;
+		mesh->normalsArray[index2 * 3 + 2] += outputz;
 	}
 	for (int i = 0; i < vertexCount; i++) {
-		normalsArray[i * 3 + 0] = normalsArray[i * 3 + 0] / (float)(numNormals[i]);
-		normalsArray[i * 3 + 1] = normalsArray[i * 3 + 1] / (float)(numNormals[i]);
-		normalsArray[i * 3 + 2] = normalsArray[i * 3 + 2] / (float)(numNormals[i]);
+		mesh->normalsArray[i * 3 + 0] = mesh->normalsArray[i * 3 + 0] / (float)(numNormals[i]);
+		mesh->normalsArray[i * 3 + 1] = mesh->normalsArray[i * 3 + 1] / (float)(numNormals[i]);
+		mesh->normalsArray[i * 3 + 2] = mesh->normalsArray[i * 3 + 2] / (float)(numNormals[i]);
 	}
 
 
 	delete[] numNormals;
+
+	if (optimize) {
+		optimizeArrays();
+	}
+}
+
+/*  ===============================================
+Desc: Runs the finished arrays through MeshOptimizer and prints what the
+	post-transform cache makes of them before and after
+	1.) Triangle order for the vertex cache
+	2.) Clusters of that order sorted for overdraw
+	3.) Vertices renumbered in the order they are first drawn
+	faceList and vertexList are renumbered as well.
+Precondition: buildArrays has filled the arrays, from faces readFaces checked
+Postcondition: the same triangles, in a different order
+=============================================== */
+void ply::optimizeArrays() {
+	int indexCount = faceCount * 3;
+	MeshOptimizer::CacheStats before = MeshOptimizer::simulateCache(mesh->indiciesArray, indexCount, vertexCount);
+	MeshOptimizer::optimizeVertexCache(mesh->indiciesArray, indexCount, vertexCount);
+	MeshOptimizer::optimizeOverdraw(mesh->indiciesArray, indexCount, mesh->vertexArray, vertexCount);
+	vector<unsigned int> remap;
+	MeshOptimizer::optimizeVertexFetch(mesh->indiciesArray, indexCount, vertexCount, mesh->vertexArray, mesh->normalsArray, remap);
+	MeshOptimizer::CacheStats after = MeshOptimizer::simulateCache(mesh->indiciesArray, indexCount, vertexCount);
+
+	for (int i = 0; faceList != NULL && i < faceCount; i++) {
+		for (int j = 0; j < faceList[i].vertexCount; j++) {
+			faceList[i].vertexList[j] = remap[faceList[i].vertexList[j]];
+		}
+	}
+	if (vertexList != NULL) {
+		vertex* reordered = new vertex[vertexCount];
+		for (int i = 0; i < vertexCount; i++) {
+			reordered[remap[i]] = vertexList[i];
+		}
+		delete[] vertexList;
+		vertexList = reordered;
+	}
+
+	cout << "optimized " << filePath.c_str() << ": ACMR " << before.acmr << " -> " << after.acmr
+		<< ", ATVR " << before.atvr << " -> " << after.atvr
+		<< " (" << MeshOptimizer::SIMULATED_CACHE_SIZE << " entry FIFO)\n";
 }
 
 void ply::bindVBO(unsigned int programID) {
+	if (mesh == NULL || mesh->indiciesArray == NULL) {
+		return;
+	}
 
 	// Use a Vertex Array Object -- think of this as a single ID that sums up all the following VBOs
+	// Attribute locations depend on the shader, so every ply has its own and a new program gets a new one
+	if (vao != -1)
+		glDeleteVertexArrays(1, &vao);
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
 	// Generate a buffer that will be sent to the video memory
-	// For each ply object, it will get its own vertex buffer object, but it
-	// would be much more efficient to put everything into one Vertex Buffer Object and send it over
-	// only once to video memory. 
+	// Every ply of the same file shares the buffers of its mesh, so only the
+	// first one to get here copies the data into video memory, the others
+	// (and later calls for new shaders) just bind them.
+	bool upload = mesh->vertexVBO_id == -1;
 
 	// Note: If this seg faults, then Glee or Glew (however OpenGL 2.0 extensions are mangaged)
 	// has not yet been initialized.
 	//tell openGL to generate a new VBO object
-	glGenBuffers(1, &vertexVBO_id);
+	if (upload)
+		glGenBuffers(1, &mesh->vertexVBO_id);
 	// Once we know how many buffers to generate, then hook up the buffer to the vertexVBO_id.
-	glBindBuffer(GL_ARRAY_BUFFER, vertexVBO_id);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexVBO_id);
 	// Now we finally copy data into the buffer object
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertexCount * 3, vertexArray, GL_STATIC_DRAW);
+	if (upload)
+		glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertexCount * 3, mesh->vertexArray, GL_STATIC_DRAW);
 
 
 	//tell openGL to generate a new VBO object
-	glGenBuffers(1, &indicesVBO_id);
+	if (upload)
+		glGenBuffers(1, &mesh->indicesVBO_id);
 	// Transfer the data from indices to a VBO indicesVBO_id
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indicesVBO_id);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indicesVBO_id);
 	// Copy data into the buffer object. Note the keyword difference here -- GL_ELEMENT_ARRAY_BUFFER
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * faceCount * 3, indiciesArray, GL_STATIC_DRAW);
+	if (upload)
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * faceCount * 3, mesh->indiciesArray, GL_STATIC_DRAW);
 	// Get the location of the attributes that enters in the vertex shader
 	GLint position_attribute = glGetAttribLocation(programID, "myPosition");
 	// Specify how the data for position can be accessed
@@ -631,11 +1345,13 @@ void ply::bindVBO(unsigned int programID) {
 
 
 	//Repeat the process as building a vertexVBO, but this time for the normals
-	glGenBuffers(1, &normalVBO_id);
+	if (upload)
+		glGenBuffers(1, &mesh->normalVBO_id);
 	// bind the newly generated buffer to the normalVBO_id.
-	glBindBuffer(GL_ARRAY_BUFFER, normalVBO_id);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->normalVBO_id);
 	// Now we finally copy data into the buffer object
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertexCount * 3, normalsArray, GL_STATIC_DRAW);
+	if (upload)
+		glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertexCount * 3, mesh->normalsArray, GL_STATIC_DRAW);
 	// Get the location of the attributes that enters in the vertex shader
 	GLint normal_attribute = glGetAttribLocation(programID, "myNormal");
 	// Specify how the data for position can be accessed
@@ -643,7 +1359,7 @@ void ply::bindVBO(unsigned int programID) {
 	// Enable the attribute
 	glEnableVertexAttribArray(normal_attribute);
 
-	cout << "Created vbo successfully" << endl;
+	cout << (upload ? "Created vbo successfully" : "Bound shared vbo successfully") << endl;
 }
 
 void ply::renderVBO(unsigned int shaderProgramID) {
@@ -5,11 +5,27 @@
 
 	Purpose:	Specification for using
 	Examples:	See example below for using PLY class
+
+	Reads ASCII and binary (little and big endian) PLY files. Positions
+	are loaded straight into vertexArray, the array the vertex buffer is
+	filled from. Large ASCII files are parsed on all cores, one record a
+	line.
+
+	The finished arrays are loaded once per run: every ply of the same
+	file shares them and their buffers. They are also written to
+	<file>.cache, which later runs read instead of the file as long as
+	the file is unchanged.
+
+	Loaded with optimize set, the triangles and vertices are reordered for
+	the GPU's vertex cache and for less overdraw (see MeshOptimizer.h).
+	Such meshes are shared and cached apart from the plain ones, in
+	<file>.opt.cache.
 	===================================================== */
 #ifndef PLY_H
 #define PLY_H
 
 #include <string>
+#include <memory>
 #include "geometry.h"
 #if defined(__APPLE__)
 #  include <OpenGL/gl3.h> // defines OpenGL 3.0+ functions
@@ -22,6 +38,27 @@
 
 using namespace std;
 
+/*  ============== plyMesh ==============
+	Purpose: The arrays the vertex buffer objects are filled from and the
+	buffers once they are uploaded. Shared by every ply loaded from the
+	same file, the last one to go deletes them.
+	==================================== */
+struct plyMesh {
+	int vertexCount;
+	int faceCount;
+	int properties;         // of a vertex in the file, for printAttributes
+	GLfloat* vertexArray;
+	GLuint* indiciesArray;
+	GLfloat* normalsArray;
+	GLuint vertexVBO_id, indicesVBO_id, normalVBO_id;
+	// content hash and size of the file the arrays were made from
+	unsigned long long sourceHash;
+	unsigned long long sourceSize;
+
+	plyMesh();
+	~plyMesh();
+};
+
 /*  ============== ply ==============
 	Purpose: Load a PLY File
 
@@ -31,6 +68,7 @@ using namespace std;
 	Example usage:
 
 	1.) ply* myPLY = new ply (filenamePath);
+	    (or new ply (filenamePath, true) to have the mesh optimized)
 	2.) myPLY->render();
 	3.) delete myPLY;
 
@@ -39,14 +77,14 @@ class ply {
 
 public:
 	ply();
-	ply(string filePath);
+	ply(string filePath, bool optimize = false);
 	~ply();
 	void reset();
 
 	/*	===============================================
 		Desc: reloads the geometry for a 3D object
 	=============================================== */
-	void reload(string _filePath);
+	void reload(string _filePath, bool _optimize = false);
 
 	/*	===============================================
 		Desc: Draws a filled 3D object
@@ -81,6 +119,9 @@ public:
 		you are reading in the correct data.
 		(Generally these would not be public functions,
 		they are here to help you understand the interface)
+		printFaceList only prints anything after a load that
+		parsed the file: meshes from the cache or from another
+		ply of the same file come without the face list.
 		=============================================== */
 	void printVertexList();
 	void printFaceList();
@@ -90,6 +131,11 @@ private:
 		Desc: Helper function used in the constructor
 		=============================================== */
 	void loadGeometry();
+	bool parseGeometry(const char* data, size_t size);
+	bool readCache();
+	void writeCache();
+	string cachePath();
+	void optimizeArrays();
 	void scaleAndCenter();
 	void setNormal(float x1, float y1, float z1,
 		float x2, float y2, float z2,
@@ -109,14 +155,17 @@ private:
 		=============================================== */
 		// Store the path to our file
 	string filePath;
+	// Whether buildArrays runs the mesh through MeshOptimizer
+	bool optimize;
 	// Stores the number of vertics loaded
 	int vertexCount;
 	// Stores the number of faces loaded
 	int faceCount;
-	// Tells us how many properites exist in the file
+	// Tells us how many properites a vertex has in the file
 	int properties;
 	// A dynamically allocated array that stores
-	// a vertex
+	// a vertex, with the normals, colours and texture
+	// coordinates the file has. NULL if it only has positions
 	vertex* vertexList;
 	// A dynamically allocated array that stores
 	// a list of faces (essentially integers that will
@@ -125,12 +174,10 @@ private:
 
 	// Id for Vertex Array Object
 	GLuint vao;
-	// Id for Vertex Buffer Object
-	GLuint vertexVBO_id, indicesVBO_id, normalVBO_id;
-	// Special arrays that are used for vertex buffer objects
-	GLfloat* vertexArray;
-	GLuint* indiciesArray;
-	GLfloat* normalsArray;
+	// Special arrays that are used for vertex buffer objects and
+	// the buffers themselves, shared with other plys of the file.
+	// vertexArray (x, y, z per vertex) is filled by the loader
+	shared_ptr<plyMesh> mesh;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "BVH.h"
+
+const int SAH_BINS = 16;
+const int MAX_LEAF_SIZE = 2;
+const int MAX_DEPTH = 48;
+const float TRAVERSAL_COST = 1.0f;
+const float INTERSECT_COST = 2.0f;
+
+BVH::BVH() {
+}
+
+BVH::~BVH() {
+}
+
+void BVH::clear() {
+	nodes.clear();
+	primIndices.clear();
+	parents.clear();
+	primLeaves.clear();
+}
+
+void BVH::build(const std::vector<AABB>& primBounds) {
+	clear();
+	if (primBounds.empty()) return;
+
+	std::vector<glm::vec3> centroids(primBounds.size());
+	primIndices.resize(primBounds.size());
+	for (size_t i = 0; i < primBounds.size(); i++) {
+		centroids[i] = primBounds[i].centroid();
+		primIndices[i] = (int)i;
+	}
+
+	// a binary tree with n leaves never has more than 2n - 1 nodes
+	nodes.reserve(primBounds.size() * 2);
+	BVHNode root;
+	root.left = 0;
+	root.count = (int)primBounds.size();
+	nodes.push_back(root);
+	subdivide(0, primBounds, centroids, 0);
+
+	// the links refit() walks up along
+	parents.assign(nodes.size(), -1);
+	primLeaves.assign(primBounds.size(), -1);
+	for (int i = 0; i < (int)nodes.size(); i++) {
+		const BVHNode& node = nodes[i];
+		if (node.count > 0) {
+			for (int p = node.left; p < node.left + node.count; p++) {
+				primLeaves[primIndices[p]] = i;
+			}
+		}
+		else {
+			parents[node.left] = i;
+			parents[node.left + 1] = i;
+		}
+	}
+}
+
+void BVH::refit(const std::vector<int>& changed, const std::vector<AABB>& primBounds) {
+	for (size_t c = 0; c < changed.size(); c++) {
+		int nodeIndex = primLeaves[changed[c]];
+		while (nodeIndex >= 0) {
+			BVHNode& node = nodes[nodeIndex];
+			AABB bounds;
+			if (node.count > 0) {
+				for (int p = node.left; p < node.left + node.count; p++) {
+					bounds.expand(primBounds[primIndices[p]]);
+				}
+			}
+			else {
+				bounds.expand(nodes[node.left].bounds);
+				bounds.expand(nodes[node.left + 1].bounds);
+			}
+			// an unchanged box leaves everything above it as it is
+			if (bounds.min == node.bounds.min && bounds.max == node.bounds.max) break;
+			node.bounds = bounds;
+			nodeIndex = parents[nodeIndex];
+		}
+	}
+}
+
+void BVH::subdivide(int nodeIndex, const std::vector<AABB>& primBounds, const std::vector<glm::vec3>& centroids, int depth) {
+	int first = nodes[nodeIndex].left;
+	int count = nodes[nodeIndex].count;
+
+	AABB bounds, centroidBounds;
+	for (int i = first; i < first + count; i++) {
+		bounds.expand(primBounds[primIndices[i]]);
+		centroidBounds.expand(centroids[primIndices[i]]);
+	}
+	nodes[nodeIndex].bounds = bounds;
+
+	if (count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH) return;
+
+	// binned SAH: try SAH_BINS - 1 split planes on every axis and keep the cheapest
+	float bestCost = std::numeric_limits<float>::infinity();
+	int bestAxis = -1;
+	int bestSplit = -1;
+	for (int axis = 0; axis < 3; axis++) {
+		float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0.0f) continue;
+
+		AABB binBounds[SAH_BINS];
+		int binCount[SAH_BINS] = { 0 };
+		float scale = SAH_BINS / extent;
+		for (int i = first; i < first + count; i++) {
+			int b = std::min(SAH_BINS - 1, (int)((centroids[primIndices[i]][axis] - centroidBounds.min[axis]) * scale));
+			binCount[b]++;
+			binBounds[b].expand(primBounds[primIndices[i]]);
+		}
+
+		// sweep from the right to get the area and count of everything after each plane
+		float rightArea[SAH_BINS - 1];
+		int rightCount[SAH_BINS - 1];
+		AABB rightBox;
+		int rightSum = 0;
+		for (int b = SAH_BINS - 1; b > 0; b--) {
+			rightBox.expand(binBounds[b]);
+			rightSum += binCount[b];
+			rightArea[b - 1] = rightBox.surfaceArea();
+			rightCount[b - 1] = rightSum;
+		}
+
+		AABB leftBox;
+		int leftSum = 0;
+		for (int b = 0; b < SAH_BINS - 1; b++) {
+			leftBox.expand(binBounds[b]);
+			leftSum += binCount[b];
+			if (leftSum == 0 || rightCount[b] == 0) continue;
+			float cost = leftSum * leftBox.surfaceArea() + rightCount[b] * rightArea[b];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	// all centroids coincide, nothing left to split on
+	if (bestAxis < 0) return;
+
+	float parentArea = bounds.surfaceArea();
+	float leafCost = INTERSECT_COST * count;
+	float splitCost = TRAVERSAL_COST + (parentArea > 0.0f ? INTERSECT_COST * bestCost / parentArea : leafCost);
+	if (splitCost >= leafCost && count <= 8) return;
+
+	float scale = SAH_BINS / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+	int* mid = std::partition(&primIndices[first], &primIndices[first] + count, [&](int index) {
+		int b = std::min(SAH_BINS - 1, (int)((centroids[index][bestAxis] - centroidBounds.min[bestAxis]) * scale));
+		return b <= bestSplit;
+	});
+	int leftCount = (int)(mid - &primIndices[first]);
+	if (leftCount == 0 || leftCount == count) return;
+
+	BVHNode leftChild, rightChild;
+	leftChild.left = first;
+	leftChild.count = leftCount;
+	rightChild.left = first + leftCount;
+	rightChild.count = count - leftCount;
+
+	int childIndex = (int)nodes.size();
+	nodes.push_back(leftChild);
+	nodes.push_back(rightChild);
+	nodes[nodeIndex].left = childIndex;
+	nodes[nodeIndex].count = 0;
+
+	subdivide(childIndex, primBounds, centroids, depth + 1);
+	subdivide(childIndex + 1, primBounds, centroids, depth + 1);
+}
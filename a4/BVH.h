@@ -0,0 +1,290 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "RayPacket.h"
+#include "Profiler.h"
+
+// axis aligned bounding box in world space
+struct AABB {
+	glm::vec3 min;
+	glm::vec3 max;
+
+	AABB() {
+		min = glm::vec3(std::numeric_limits<float>::infinity());
+		max = glm::vec3(-std::numeric_limits<float>::infinity());
+	}
+
+	void expand(const glm::vec3& p) {
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	void expand(const AABB& box) {
+		min = glm::min(min, box.min);
+		max = glm::max(max, box.max);
+	}
+
+	glm::vec3 centroid() const {
+		return (min + max) * 0.5f;
+	}
+
+	float surfaceArea() const {
+		glm::vec3 d = max - min;
+		if (d.x < 0 || d.y < 0 || d.z < 0) return 0.0f;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	/* Slab test against the ray (origin, invDir). Returns true if the ray overlaps
+	   the box somewhere in [tMin, tMax] and writes the entry distance to tNear.
+	   invDir is 1/dir per component, so a zero component becomes +-infinity. */
+	bool intersect(const glm::vec3& origin, const glm::vec3& invDir, float tMin, float tMax, float& tNear) const {
+		for (int a = 0; a < 3; a++) {
+			float t1 = (min[a] - origin[a]) * invDir[a];
+			float t2 = (max[a] - origin[a]) * invDir[a];
+			// 0 * inf gives NaN when the origin sits on a slab plane, keep the interval open then
+			if (t1 != t1 || t2 != t2) continue;
+			if (t1 > t2) std::swap(t1, t2);
+			tMin = std::max(tMin, t1);
+			tMax = std::min(tMax, t2);
+			if (tMin > tMax) return false;
+		}
+		tNear = tMin;
+		return true;
+	}
+
+	/* Slab test for every lane of a packet, the same steps as intersect() with the
+	   early outs turned into a mask. Lane i is tested over [0, tMax[i]]; laneHit and
+	   tNear get one entry per lane. Returns true if any lane overlaps the box. */
+	template <int N>
+	bool intersectPacket(const RayPacket<N>& rays, const float invDir[3][N], const float* tMax, bool* laneHit, float* tNear) const {
+		const float* origin[3] = { rays.ox, rays.oy, rays.oz };
+		float lo[N], hi[N];
+		bool hit[N];
+		for (int i = 0; i < N; i++) {
+			lo[i] = 0.0f;
+			hi[i] = tMax[i];
+			hit[i] = true;
+		}
+		for (int a = 0; a < 3; a++) {
+			for (int i = 0; i < N; i++) {
+				float t1 = (min[a] - origin[a][i]) * invDir[a][i];
+				float t2 = (max[a] - origin[a][i]) * invDir[a][i];
+				bool nan = t1 != t1 || t2 != t2;
+				float tEnter = t1 > t2 ? t2 : t1;
+				float tExit = t1 > t2 ? t1 : t2;
+				lo[i] = nan ? lo[i] : std::max(lo[i], tEnter);
+				hi[i] = nan ? hi[i] : std::min(hi[i], tExit);
+				hit[i] = hit[i] && !(lo[i] > hi[i]);
+			}
+		}
+		bool any = false;
+		for (int i = 0; i < N; i++) {
+			laneHit[i] = hit[i];
+			tNear[i] = lo[i];
+			any = any || hit[i];
+		}
+		return any;
+	}
+};
+
+// flattened tree node, children of an interior node are stored at left and left + 1
+struct BVHNode {
+	AABB bounds;
+	int left;       // first child for interior nodes, first entry in primIndices for leaves
+	int count;      // number of primitives in a leaf, 0 for interior nodes
+};
+
+class BVH {
+public:
+	BVH();
+	~BVH();
+
+	// builds the hierarchy with the surface area heuristic, one box per scene object
+	void build(const std::vector<AABB>& primBounds);
+	/* Moves the primitives in changed to their boxes in primBounds without rebuilding:
+	   the nodes above them grow or shrink to fit, the tree keeps its shape. Costs the
+	   changed primitives times the depth, but the tree gets worse the further things
+	   move from where they were when it was built. */
+	void refit(const std::vector<int>& changed, const std::vector<AABB>& primBounds);
+	void clear();
+	bool empty() const { return nodes.empty(); }
+
+	/* Closest hit query. intersectFn(index) returns the ray parameter t of primitive
+	   index, or a value <= tMin for a miss. Among equal t the lowest index wins so the
+	   result matches a linear scan over the scene in order. Returns -1 if nothing was hit. */
+	template <typename IntersectFn>
+	int intersectClosest(const glm::vec3& origin, const glm::vec3& dir, float tMin, float& tHit, IntersectFn intersectFn) const {
+		int hitIndex = -1;
+		tHit = std::numeric_limits<float>::infinity();
+		if (nodes.empty()) return -1;
+
+		glm::vec3 invDir = glm::vec3(1.0f) / dir;
+		int stack[64];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0) {
+			const BVHNode& node = nodes[stack[--stackSize]];
+			PROFILE_COUNT(COUNTER_BVH_NODES);
+			float tNear;
+			// boxes entered exactly at tHit are still visited so ties resolve by index
+			if (!node.bounds.intersect(origin, invDir, 0.0f, tHit, tNear)) continue;
+
+			if (node.count > 0) {
+				for (int i = node.left; i < node.left + node.count; i++) {
+					int index = primIndices[i];
+					float t = intersectFn(index);
+					if (t > tMin && (t < tHit || (t == tHit && index < hitIndex))) {
+						tHit = t;
+						hitIndex = index;
+					}
+				}
+			}
+			else {
+				// visit the nearer child first
+				int first = node.left;
+				int second = node.left + 1;
+				float tFirst, tSecond;
+				bool hitFirst = nodes[first].bounds.intersect(origin, invDir, 0.0f, tHit, tFirst);
+				bool hitSecond = nodes[second].bounds.intersect(origin, invDir, 0.0f, tHit, tSecond);
+				if (hitFirst && hitSecond) {
+					if (tSecond < tFirst) std::swap(first, second);
+					stack[stackSize++] = second;
+					stack[stackSize++] = first;
+				}
+				else if (hitFirst) {
+					stack[stackSize++] = first;
+				}
+				else if (hitSecond) {
+					stack[stackSize++] = second;
+				}
+			}
+		}
+		return hitIndex;
+	}
+
+	/* Closest hit query for a packet of rays. The packet walks the tree together and a
+	   node is opened when any of its lanes overlaps the box. intersectFn(index, t)
+	   writes the t of primitive index for all N lanes (<= tMin is a miss). Every lane
+	   ends up with the same tHit and hitIndex that intersectClosest would give it. */
+	template <int N, typename IntersectFn>
+	void intersectClosestPacket(const RayPacket<N>& rays, float tMin, float* tHit, int* hitIndex, IntersectFn intersectFn) const {
+		for (int i = 0; i < N; i++) {
+			tHit[i] = std::numeric_limits<float>::infinity();
+			hitIndex[i] = -1;
+		}
+		if (nodes.empty()) return;
+
+		float invDir[3][N];
+		for (int i = 0; i < N; i++) {
+			invDir[0][i] = 1.0f / rays.dx[i];
+			invDir[1][i] = 1.0f / rays.dy[i];
+			invDir[2][i] = 1.0f / rays.dz[i];
+		}
+		int stack[64];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+
+		bool laneHit[N];
+		float tNear[N];
+		float t[N];
+		while (stackSize > 0) {
+			const BVHNode& node = nodes[stack[--stackSize]];
+			PROFILE_COUNT(COUNTER_BVH_NODES);
+			if (!node.bounds.intersectPacket(rays, invDir, tHit, laneHit, tNear)) continue;
+
+			if (node.count > 0) {
+				for (int p = node.left; p < node.left + node.count; p++) {
+					int index = primIndices[p];
+					intersectFn(index, t);
+					// lanes that missed the box keep their result, exactly like the scalar walk
+					for (int i = 0; i < N; i++) {
+						if (laneHit[i] && t[i] > tMin && (t[i] < tHit[i] || (t[i] == tHit[i] && index < hitIndex[i]))) {
+							tHit[i] = t[i];
+							hitIndex[i] = index;
+						}
+					}
+				}
+			}
+			else {
+				// visit the child the packet reaches first before the other one
+				int first = node.left;
+				int second = node.left + 1;
+				float tFirst, tSecond;
+				bool hitFirst = packetEntry(nodes[first].bounds, rays, invDir, tHit, tFirst);
+				bool hitSecond = packetEntry(nodes[second].bounds, rays, invDir, tHit, tSecond);
+				if (hitFirst && hitSecond) {
+					if (tSecond < tFirst) std::swap(first, second);
+					stack[stackSize++] = second;
+					stack[stackSize++] = first;
+				}
+				else if (hitFirst) {
+					stack[stackSize++] = first;
+				}
+				else if (hitSecond) {
+					stack[stackSize++] = second;
+				}
+			}
+		}
+	}
+
+	/* Any hit query for shadow rays. occludesFn(index) returns true if primitive index
+	   blocks the ray, traversal stops at the first blocker and returns its index, -1 if
+	   nothing is in the way. */
+	template <typename OccludesFn>
+	int intersectAny(const glm::vec3& origin, const glm::vec3& dir, float tMax, OccludesFn occludesFn) const {
+		if (nodes.empty()) return -1;
+
+		glm::vec3 invDir = glm::vec3(1.0f) / dir;
+		int stack[64];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0) {
+			const BVHNode& node = nodes[stack[--stackSize]];
+			PROFILE_COUNT(COUNTER_BVH_NODES);
+			float tNear;
+			if (!node.bounds.intersect(origin, invDir, 0.0f, tMax, tNear)) continue;
+
+			if (node.count > 0) {
+				for (int i = node.left; i < node.left + node.count; i++) {
+					if (occludesFn(primIndices[i])) return primIndices[i];
+				}
+			}
+			else {
+				stack[stackSize++] = node.left + 1;
+				stack[stackSize++] = node.left;
+			}
+		}
+		return -1;
+	}
+
+	std::vector<BVHNode> nodes;
+	std::vector<int> primIndices;
+
+private:
+	std::vector<int> parents;       // per node, -1 for the root
+	std::vector<int> primLeaves;    // per primitive, the leaf holding it
+
+	// true if any lane overlaps box, entry is the nearest entry distance over those lanes
+	template <int N>
+	static bool packetEntry(const AABB& box, const RayPacket<N>& rays, const float invDir[3][N], const float* tMax, float& entry) {
+		bool laneHit[N];
+		float tNear[N];
+		if (!box.intersectPacket(rays, invDir, tMax, laneHit, tNear)) return false;
+		entry = std::numeric_limits<float>::infinity();
+		for (int i = 0; i < N; i++) {
+			if (laneHit[i]) entry = std::min(entry, tNear[i]);
+		}
+		return true;
+	}
+
+	void subdivide(int nodeIndex, const std::vector<AABB>& primBounds, const std::vector<glm::vec3>& centroids, int depth);
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "Camera.h"
 
+#include <algorithm>
+
 Camera::Camera()
 {
 	reset();
@@ -20,6 +22,8 @@ void Camera::reset()
 	screenWidth = screenHeight = 200;
 	screenWidthRatio = 1.0f;
 	rotU = rotV = rotW = 0;
+	aperture = 0.0f;
+	focalDistance = DEFAULT_FOCUS_LENGTH;
 }
 
 // called by main.cpp as a part of the slider callback for controlling rotation
@@ -127,6 +131,61 @@ glm::mat4 Camera::getInverseModelViewMatrix()
 	return glm::inverse(getModelViewMatrix());
 }
 
+// Pixel (x, y) maps to normalized device coordinates (2x / width - 1, 2y / height - 1),
+// which the projection puts at camera space (ndcX * tan * aspect, ndcY * tan, -1) with
+// tan the tangent of half the view angle. In world space that is -w + ... * u + ... * v.
+RayGenerator Camera::getRayGenerator()
+{
+	float tanHalfAngle = tan(glm::radians(viewAngle / 2.0f));
+	glm::vec3 right = u * (tanHalfAngle * screenWidthRatio);
+	glm::vec3 up = v * tanHalfAngle;
+
+	RayGenerator generator;
+	generator.eyePoint = eyePoint;
+	generator.corner = -w - right - up;
+	generator.stepX = right * (2.0f / screenWidth);
+	generator.stepY = up * (2.0f / screenHeight);
+	generator.thinLens = aperture > 0.0f;
+	generator.lensU = u * (aperture / 2.0f);
+	generator.lensV = v * (aperture / 2.0f);
+	generator.focalDistance = focalDistance;
+	return generator;
+}
+
+glm::vec3 RayGenerator::generate(int x, int y) const
+{
+	return glm::normalize(corner + stepX * (float)x + stepY * (float)y);
+}
+
+glm::vec3 RayGenerator::generateSample(float x, float y) const
+{
+	return glm::normalize(corner + stepX * x + stepY * y);
+}
+
+void RayGenerator::generateScanline(int x, int y, int count, glm::vec3* rays) const
+{
+	glm::vec3 dir = corner + stepX * (float)x + stepY * (float)y;
+	for (int i = 0; i < count; i++) {
+		rays[i] = glm::normalize(dir);
+		dir += stepX;
+	}
+}
+
+void RayGenerator::generateTile(int x, int y, int width, int height, glm::vec3* rays) const
+{
+	for (int row = 0; row < height; row++) {
+		generateScanline(x, y + row, width, rays + row * width);
+	}
+}
+
+void RayGenerator::generateLensSample(float x, float y, float lensX, float lensY, glm::vec3& origin, glm::vec3& dir) const
+{
+	// the unnormalized pinhole direction is one unit deep along -w, so this lands on the focal plane
+	glm::vec3 focus = eyePoint + (corner + stepX * x + stepY * y) * focalDistance;
+	origin = eyePoint + lensU * lensX + lensV * lensY;
+	dir = glm::normalize(focus - origin);
+}
+
 void Camera::rotateV(float degrees)
 {
 	glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(degrees), v);
@@ -188,6 +247,28 @@ float Camera::getViewAngle()
 	return viewAngle;
 }
 
+void Camera::setAperture(float _aperture)
+{
+	aperture = std::max(_aperture, 0.0f);
+}
+
+void Camera::setFocalDistance(float _focalDistance)
+{
+	if (_focalDistance > 0.0f) {
+		focalDistance = _focalDistance;
+	}
+}
+
+float Camera::getAperture()
+{
+	return aperture;
+}
+
+float Camera::getFocalDistance()
+{
+	return focalDistance;
+}
+
 float Camera::getNearPlane()
 {
 	return nearPlane;
@@ -216,4 +297,4 @@ float Camera::getFilmPlanDepth()
 float Camera::getScreenWidthRatio()
 {
 	return screenWidthRatio;
-}
\ No newline at end of file
+}
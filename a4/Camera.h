@@ -10,6 +10,34 @@
 #define FAR_PLANE 20.0f
 #define VIEW_ANGLE 60.0f
 
+/* Primary ray directions for one frame, built by Camera::getRayGenerator() from the
+   u, v, w basis and the view angle instead of inverting the projection per pixel.
+   The unnormalized direction is linear in the pixel coordinates, so walking along a
+   scanline only adds stepX. */
+struct RayGenerator {
+	glm::vec3 eyePoint;
+	glm::vec3 corner;       // unnormalized direction through pixel (0, 0)
+	glm::vec3 stepX;        // added per pixel to the right
+	glm::vec3 stepY;        // added per pixel up
+	bool thinLens;          // the camera has an aperture, primary rays start anywhere on the lens
+	glm::vec3 lensU;        // radius of the lens along the camera's u and v
+	glm::vec3 lensV;
+	float focalDistance;    // points this far in front of the lens are in focus
+
+	// normalized direction through pixel (x, y)
+	glm::vec3 generate(int x, int y) const;
+	// normalized direction through a point of the image plane, pixel (x, y) sits at (x, y)
+	glm::vec3 generateSample(float x, float y) const;
+	// directions of count pixels of row y starting at x, incrementally along the row
+	void generateScanline(int x, int y, int count, glm::vec3* rays) const;
+	// directions of the width x height block at (x, y), row by row from the bottom
+	void generateTile(int x, int y, int width, int height, glm::vec3* rays) const;
+	/* Thin lens ray through image point (x, y) from point (lensX, lensY) of the unit
+	   disk scaled to the lens: it starts on the lens and passes through the point the
+	   pinhole ray meets at the focal distance, which stays sharp. */
+	void generateLensSample(float x, float y, float lensX, float lensY, glm::vec3& origin, glm::vec3& dir) const;
+};
+
 
 class Camera {
 public:
@@ -18,6 +46,7 @@ public:
 	int screenWidth, screenHeight;
 	float screenWidthRatio; // m_screenHeightRatio;
 	float rotU, rotV, rotW;
+	float aperture, focalDistance;
 
 	Camera();
 	~Camera();
@@ -28,6 +57,10 @@ public:
 	void setNearPlane (float _nearPlane);
 	void setFarPlane (float _farPlane);
 	void setScreenSize (int _screenWidth, int _screenHeight);
+	// lens diameter in world units, 0 is a pinhole and keeps everything sharp
+	void setAperture (float _aperture);
+	// distance from the eye to the plane in focus
+	void setFocalDistance (float _focalDistance);
 
 	glm::mat4 getModelViewMatrix();
 
@@ -38,6 +71,9 @@ public:
 
 	glm::mat4 getInverseModelViewMatrix();
 
+	// ray generator for the current orientation, view angle and screen size
+	RayGenerator getRayGenerator();
+
 	void setRotUVW(float u, float v, float w);
 
 	void rotateV(float angle);
@@ -58,6 +94,8 @@ public:
 
 	float getFilmPlanDepth();
 	float getScreenWidthRatio();
+	float getAperture();
+	float getFocalDistance();
 
 
 
@@ -0,0 +1,119 @@
+#ifndef COMPILEDSCENE_H
+#define COMPILEDSCENE_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Shape.h"
+#include "scene/SceneData.h"
+
+class Mesh;
+
+// material of a primitive packed into one record, only the rgb of each color is kept
+struct MaterialRecord {
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	glm::vec3 reflective;
+	float shininess;
+	float blend;
+	int texture;            // handle in the ray tracer's TextureStore, -1 if untextured
+	int repeatU, repeatV;   // texture repeats, truncated to whole tiles
+};
+
+/* Light resolved out of the parser, direction is normalized and points towards the
+   light, so spot and area lights shine along -direction. Area lights are the
+   rectangle position +- axisU +- axisV, spot lights the disk of radius |axisU|
+   around position, both facing -direction. */
+struct LightRecord {
+	glm::vec3 color;
+	LightType type;
+	glm::vec3 position;     // all but directional lights
+	glm::vec3 direction;
+	glm::vec3 function;     // distance attenuation 1 / (x + y d + z d^2)
+	glm::vec3 axisU, axisV; // half extents of the emitter, zero for a point
+	float cosOuter;         // spot lights reach nothing outside this cone
+	float cosInner;         // and shine at full strength inside this one
+	bool hasExtent;         // sampled over its area for soft shadows, otherwise one shadow ray
+};
+
+// one object in the array of its primitive type
+struct PrimitiveRecord {
+	glm::mat4 inverseTransformMatrix;
+	glm::mat3 normalMatrix;
+	int material;           // index into CompiledScene::materials
+};
+
+/* Flat copy of the scene built after the scene graph is traversed. Objects are
+   identified by their index in sceneObjects (the same index the BVH uses) and
+   live in one contiguous array per primitive type, so intersecting and shading
+   only index into arrays and never follow a pointer back into the parser. */
+struct CompiledScene {
+	std::vector<PrimitiveRecord> cubes;
+	std::vector<PrimitiveRecord> cylinders;
+	std::vector<PrimitiveRecord> cones;
+	std::vector<PrimitiveRecord> spheres;
+	std::vector<PrimitiveRecord> tori;
+	std::vector<PrimitiveRecord> meshes;
+	std::vector<Mesh*> meshModels;      // per entry in meshes, the shared triangles it instances
+
+	std::vector<OBJ_TYPE> objectTypes;  // per object, the type whose array (and intersection) it uses
+	std::vector<int> objectSlots;       // per object, its index in that array
+
+	std::vector<MaterialRecord> materials;
+	std::vector<LightRecord> lights;
+
+	void clear() {
+		cubes.clear();
+		cylinders.clear();
+		cones.clear();
+		spheres.clear();
+		tori.clear();
+		meshes.clear();
+		meshModels.clear();
+		objectTypes.clear();
+		objectSlots.clear();
+		materials.clear();
+		lights.clear();
+	}
+
+	// array that objects of type are added to while compiling
+	std::vector<PrimitiveRecord>& primitives(OBJ_TYPE type) {
+		switch (type) {
+		case SHAPE_CYLINDER:
+			return cylinders;
+		case SHAPE_CONE:
+			return cones;
+		case SHAPE_SPHERE:
+			return spheres;
+		case SHAPE_SPECIAL1:
+			return tori;
+		case SHAPE_MESH:
+			return meshes;
+		case SHAPE_CUBE:
+		default:
+			return cubes;
+		}
+	}
+
+	const PrimitiveRecord& primitive(int object) const {
+		int slot = objectSlots[object];
+		switch (objectTypes[object]) {
+		case SHAPE_CYLINDER:
+			return cylinders[slot];
+		case SHAPE_CONE:
+			return cones[slot];
+		case SHAPE_SPHERE:
+			return spheres[slot];
+		case SHAPE_SPECIAL1:
+			return tori[slot];
+		case SHAPE_MESH:
+			return meshes[slot];
+		case SHAPE_CUBE:
+		default:
+			return cubes[slot];
+		}
+	}
+};
+
+#endif
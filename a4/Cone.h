@@ -12,8 +12,7 @@ public:
 		return SHAPE_CONE;
 	}
 
-    float intersect(glm::vec3 eyePointP, glm::vec3 rayV, glm::mat4 transformMatrix) {
-        glm::mat4 inverseMatrix = glm::inverse(transformMatrix);
+    float intersect(glm::vec3 eyePointP, glm::vec3 rayV, const glm::mat4& inverseMatrix) {
         
         // Convert to object space
         glm::vec4 objP = inverseMatrix * glm::vec4(eyePointP, 1.0f);
@@ -65,9 +64,48 @@ public:
         float t = std::min(t_body, t_cap);
         return t == std::numeric_limits<float>::infinity() ? -1 : t;
     }
+
+    // packet version of intersect(), body and base cap are both evaluated for every lane
+    template <int N>
+    void intersectPacket(const RayPacket<N>& rays, const glm::mat4& inverseMatrix, float* tOut) {
+        const float INF = std::numeric_limits<float>::infinity();
+        const float height = 1.0f;
+        const float apex_y = 0.5f;
+        const float r = 0.5f;
+        const float r_squared = r * r;
+        const float h_squared = height * height;
+        ObjectSpacePacket<N> obj(rays, inverseMatrix);
+        for (int i = 0; i < N; i++) {
+            float Px = obj.Px[i], Py = obj.Py[i], Pz = obj.Pz[i];
+            float dx = obj.dx[i], dy = obj.dy[i], dz = obj.dz[i];
+
+            float a = dx * dx + dz * dz - (dy * dy * r_squared / h_squared);
+            float b = 2.0f * (Px * dx + Pz * dz +
+                             (apex_y - Py) * dy * r_squared / h_squared);
+            float c = Px * Px + Pz * Pz -
+                     ((apex_y - Py) * (apex_y - Py) * r_squared / h_squared);
+            float discriminant = b * b - 4.0f * a * c;
+
+            // same sqrt overload (and rounding) as intersect()
+            auto root = sqrt(discriminant >= 0 ? discriminant : 0.0f);
+            float t1 = (-b - root) / (2.0f * a);
+            float t2 = (-b + root) / (2.0f * a);
+            float y1 = Py + t1 * dy;
+            float y2 = Py + t2 * dy;
+            float t_body = (t1 > 0 && y1 >= -0.5f && y1 <= 0.5f) ? t1 : (t2 > 0 && y2 >= -0.5f && y2 <= 0.5f) ? t2 : INF;
+            t_body = discriminant >= 0 ? t_body : INF;
+
+            float tc = (-0.5f - Py) / dy;
+            float x = Px + tc * dx, z = Pz + tc * dz;
+            float t_cap = (std::abs(dy) > 1e-6 && tc > 0 && (x * x + z * z) <= r_squared) ? tc : INF;
+
+            float t = std::min(t_body, t_cap);
+            tOut[i] = t == INF ? -1.0f : t;
+        }
+    }
     
-	float draw(glm::vec3 eyePoint, glm::vec3 ray, glm::mat4 transformMatrix) {
-		return intersect(eyePoint, ray, transformMatrix);
+	float draw(glm::vec3 eyePoint, glm::vec3 ray, const glm::mat4& inverseMatrix) {
+		return intersect(eyePoint, ray, inverseMatrix);
 	};
 
 	
@@ -92,10 +130,7 @@ public:
     }
 
 
-    glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, glm::mat4 transformMatrix, double t) {
-        glm::mat4 inverseMatrix = glm::inverse(transformMatrix);
-        // Convert eye point to object space - should use w=1.0 for rays
-        glm::vec4 objP = inverseMatrix * glm::vec4(eyePoint, 1.0f);
+    glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, const glm::mat4& inverseMatrix, const glm::mat3& normalMatrix, double t) {
         // Convert ray to object space - should use w=0.0 for vectors
         glm::vec4 intersectPoint = inverseMatrix * glm::vec4(worldSpacePos, 1.0f);
 
@@ -115,9 +150,7 @@ public:
                 intersectPoint.z));
         }
 
-        // Transform normal to world coordinates using the normal transform matrix
-        // For normals, we need to use the transpose of the inverse of the 3x3 part
-        glm::mat3 normalMatrix = glm::transpose(glm::mat3(inverseMatrix));
+        // Transform normal to world coordinates using the precomputed normal matrix
         glm::vec3 worldNormal = glm::normalize(normalMatrix * normalObj);
 
         return worldNormal;
@@ -12,8 +12,7 @@ public:
 		return SHAPE_CUBE;
 	}
 
-    double intersect(glm::vec3 eyePointP, glm::vec3 rayV, glm::mat4 transformMatrix) {
-        glm::mat4 inverseMatrix = glm::inverse(transformMatrix);
+    double intersect(glm::vec3 eyePointP, glm::vec3 rayV, const glm::mat4& inverseMatrix) {
         
         // Convert to object space
         glm::vec4 objP = inverseMatrix * glm::vec4(eyePointP, 1.0f);
@@ -71,8 +70,36 @@ public:
         return -1;
     }
 
-	float draw(glm::vec3 eyePoint, glm::vec3 ray, glm::mat4 transformMatrix) {
-        return intersect(eyePoint, ray, transformMatrix);
+    // packet version of intersect(), a lane that misses a slab is masked out instead of returning
+    template <int N>
+    void intersectPacket(const RayPacket<N>& rays, const glm::mat4& inverseMatrix, float* tOut) {
+        ObjectSpacePacket<N> obj(rays, inverseMatrix);
+        for (int i = 0; i < N; i++) {
+            float P[3] = { obj.Px[i], obj.Py[i], obj.Pz[i] };
+            float d[3] = { obj.dx[i], obj.dy[i], obj.dz[i] };
+            float t_min = -std::numeric_limits<float>::infinity();
+            float t_max = std::numeric_limits<float>::infinity();
+            bool hit = true;
+
+            for (int a = 0; a < 3; a++) {
+                bool parallel = std::abs(d[a]) < 1e-6;
+                float t1 = (-0.5f - P[a]) / d[a];
+                float t2 = (0.5f - P[a]) / d[a];
+                float tNear = t1 > t2 ? t2 : t1;
+                float tFar = t1 > t2 ? t1 : t2;
+                float newMin = std::max(t_min, tNear);
+                float newMax = std::min(t_max, tFar);
+                hit = hit && (parallel ? !(P[a] < -0.5f || P[a] > 0.5f) : !(newMin > newMax));
+                t_min = parallel ? t_min : newMin;
+                t_max = parallel ? t_max : newMax;
+            }
+            float t = (t_min > 0) ? t_min : (t_max > 0) ? t_max : -1.0f;
+            tOut[i] = hit ? t : -1.0f;
+        }
+    }
+
+	float draw(glm::vec3 eyePoint, glm::vec3 ray, const glm::mat4& inverseMatrix) {
+        return intersect(eyePoint, ray, inverseMatrix);
 	};
 
     glm::vec2 getUVCoordinates(glm::vec3 ray) {
@@ -113,10 +140,7 @@ public:
         return uv;
     }
 
-    glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, glm::mat4 transformMatrix, double t) {
-        glm::mat4 inverseMatrix = glm::inverse(transformMatrix);
-        // Convert eye point to object space - should use w=1.0 for points
-        glm::vec4 objP = inverseMatrix * glm::vec4(eyePoint, 1.0f);
+    glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, const glm::mat4& inverseMatrix, const glm::mat3& normalMatrix, double t) {
         // Convert ray to object space - should use w=0.0 for vectors
         glm::vec4 intersectPoint = inverseMatrix * glm::vec4(worldSpacePos, 1.0f);
 
@@ -136,9 +160,7 @@ public:
         else
             normalObj = glm::vec3(0, 0, glm::sign(intersectPoint.z));
 
-        // Transform normal to world coordinates using the normal transform matrix
-        // For normals, we need to use the transpose of the inverse of the 3x3 part
-        glm::mat3 normalMatrix = glm::transpose(glm::mat3(inverseMatrix));
+        // Transform normal to world coordinates using the precomputed normal matrix
         glm::vec3 worldNormal = glm::normalize(normalMatrix * normalObj);
 
         return worldNormal;
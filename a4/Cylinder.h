@@ -31,8 +31,7 @@ public:
         return glm::vec2(u, v);
     }
 
-    float intersect(glm::vec3 eyePointP, glm::vec3 rayV, glm::mat4 transformMatrix) {
-        glm::mat4 inverseMatrix = glm::inverse(transformMatrix);
+    float intersect(glm::vec3 eyePointP, glm::vec3 rayV, const glm::mat4& inverseMatrix) {
         glm::vec4 objP = inverseMatrix * glm::vec4(eyePointP, 1.0f);
         glm::vec4 objRay = inverseMatrix * glm::vec4(rayV, 0.0f);
         
@@ -77,8 +76,45 @@ public:
         return t == std::numeric_limits<float>::infinity() ? -1 : t;
     }
 
-	float draw(glm::vec3 eyePoint, glm::vec3 ray, glm::mat4 transformMatrix) {
-        return intersect(eyePoint, ray, transformMatrix);
+    // packet version of intersect(), body and caps are both evaluated for every lane
+    template <int N>
+    void intersectPacket(const RayPacket<N>& rays, const glm::mat4& inverseMatrix, float* tOut) {
+        const float INF = std::numeric_limits<float>::infinity();
+        const float radius = 0.5f;
+        ObjectSpacePacket<N> obj(rays, inverseMatrix);
+        for (int i = 0; i < N; i++) {
+            float Px = obj.Px[i], Py = obj.Py[i], Pz = obj.Pz[i];
+            float dx = obj.dx[i], dy = obj.dy[i], dz = obj.dz[i];
+
+            float a = dx * dx + dz * dz;
+            float b = 2.0f * (Px * dx + Pz * dz);
+            float c = Px * Px + Pz * Pz - radius * radius;
+            float discriminant = b * b - 4.0f * a * c;
+
+            // same sqrt overload (and rounding) as intersect()
+            auto root = sqrt(discriminant >= 0 ? discriminant : 0.0f);
+            float t1 = (-b - root) / (2.0f * a);
+            float t2 = (-b + root) / (2.0f * a);
+            float y1 = -(Py + t1 * dy);
+            float y2 = -(Py + t2 * dy);
+            float t_body = (t1 > 0 && y1 >= -0.5f && y1 <= 0.5f) ? t1 : (t2 > 0 && y2 >= -0.5f && y2 <= 0.5f) ? t2 : INF;
+            t_body = discriminant >= 0 ? t_body : INF;
+
+            float c1 = (0.5f - Py) / dy;
+            float c2 = (-0.5f - Py) / dy;
+            float x1 = Px + c1 * dx, z1 = Pz + c1 * dz;
+            float x2 = Px + c2 * dx, z2 = Pz + c2 * dz;
+            float t_caps = (c1 > 0 && x1 * x1 + z1 * z1 <= radius * radius) ? c1 : INF;
+            if (c2 > 0 && x2 * x2 + z2 * z2 <= radius * radius) t_caps = (t_caps == INF) ? c2 : std::min(t_caps, c2);
+            t_caps = std::abs(dy) > 1e-6 ? t_caps : INF;
+
+            float t = std::min(t_body, t_caps);
+            tOut[i] = t == INF ? -1.0f : t;
+        }
+    }
+
+	float draw(glm::vec3 eyePoint, glm::vec3 ray, const glm::mat4& inverseMatrix) {
+        return intersect(eyePoint, ray, inverseMatrix);
 	};
 
 	//glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 ray, glm::mat4 transformMatrix, double t) {
@@ -108,10 +144,7 @@ public:
  //       return worldNormal;
 	//};
 
-    glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, glm::mat4 transformMatrix, double t) {
-        glm::mat4 inverseMatrix = glm::inverse(transformMatrix);
-        // Convert eye point to object space - should use w=1.0 for points
-        glm::vec4 objP = inverseMatrix * glm::vec4(eyePoint, 1.0f);
+    glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, const glm::mat4& inverseMatrix, const glm::mat3& normalMatrix, double t) {
         // Convert ray to object space - should use w=0.0 for vectors
         glm::vec4 intersectPoint = inverseMatrix * glm::vec4(worldSpacePos, 1.0f);
 
@@ -130,9 +163,7 @@ public:
             normalObj = glm::normalize(glm::vec3(intersectPoint.x, 0, intersectPoint.z));
         }
 
-        // Transform normal to world coordinates using the normal transform matrix
-        // For normals, we need to use the transpose of the inverse of the 3x3 part
-        glm::mat3 normalMatrix = glm::transpose(glm::mat3(inverseMatrix));
+        // Transform normal to world coordinates using the precomputed normal matrix
         glm::vec3 worldNormal = glm::normalize(normalMatrix * normalObj);
 
         return worldNormal;
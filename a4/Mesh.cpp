@@ -0,0 +1,165 @@
+#include "Mesh.h"
+#include "ply.h"
+
+#include <iostream>
+#include <cmath>
+
+Mesh::Mesh() {
+}
+
+Mesh::~Mesh() {
+}
+
+bool Mesh::load(const std::string& fileName, ThreadPool* pool) {
+	triangles.clear();
+	indices.clear();
+	normals.clear();
+	bounds = AABB();
+	bvh.clear();
+
+	ply model(fileName, pool);
+	const float* vertexList = model.getPositions();
+	const int* faceStarts = model.getFaceStarts();
+	const int* faceIndices = model.getFaceIndices();
+	if (vertexList == NULL || faceStarts == NULL || faceIndices == NULL) {
+		return false;
+	}
+
+	std::vector<glm::vec3> positions(model.getVertexCount());
+	for (int i = 0; i < model.getVertexCount(); i++) {
+		positions[i] = glm::vec3(vertexList[i * 3], vertexList[i * 3 + 1], vertexList[i * 3 + 2]);
+	}
+
+	// faces with more than three corners are split into a fan around their first vertex
+	indices.reserve((size_t)model.getFaceCount() * 3);
+	for (int i = 0; i < model.getFaceCount(); i++) {
+		const int* polygon = faceIndices + faceStarts[i];
+		int corners = faceStarts[i + 1] - faceStarts[i];
+		for (int j = 1; j + 1 < corners; j++) {
+			int a = polygon[0];
+			int b = polygon[j];
+			int c = polygon[j + 1];
+			if (a < 0 || b < 0 || c < 0 || a >= (int)positions.size() || b >= (int)positions.size() || c >= (int)positions.size()) {
+				continue;
+			}
+			indices.push_back(a);
+			indices.push_back(b);
+			indices.push_back(c);
+		}
+	}
+	if (indices.empty()) {
+		return false;
+	}
+
+	// smooth normals as in a3: sum the face normals at every vertex, normalizing takes care of the average
+	normals.assign(positions.size(), glm::vec3(0.0f));
+	int triangleCount = (int)indices.size() / 3;
+	triangles.resize(triangleCount);
+	std::vector<AABB> triangleBounds(triangleCount);
+	for (int i = 0; i < triangleCount; i++) {
+		const glm::vec3& p0 = positions[indices[i * 3]];
+		const glm::vec3& p1 = positions[indices[i * 3 + 1]];
+		const glm::vec3& p2 = positions[indices[i * 3 + 2]];
+		Triangle& triangle = triangles[i];
+		triangle.v0 = p0;
+		triangle.edge1 = p1 - p0;
+		triangle.edge2 = p2 - p0;
+
+		glm::vec3 faceNormal = glm::cross(triangle.edge1, triangle.edge2);
+		float length = glm::length(faceNormal);
+		if (length > 0.0f) {
+			faceNormal /= length;
+			for (int k = 0; k < 3; k++) {
+				normals[indices[i * 3 + k]] += faceNormal;
+			}
+		}
+
+		triangleBounds[i].expand(p0);
+		triangleBounds[i].expand(p1);
+		triangleBounds[i].expand(p2);
+		bounds.expand(triangleBounds[i]);
+	}
+	for (size_t i = 0; i < normals.size(); i++) {
+		float length = glm::length(normals[i]);
+		if (length > 0.0f) normals[i] /= length;
+	}
+
+	bvh.build(triangleBounds);
+	std::cout << "mesh " << fileName << ": " << triangleCount << " triangles, " << bvh.nodes.size() << " BVH nodes" << std::endl;
+	return true;
+}
+
+// spherical projection around the center, PLY files carry no texture coordinates
+glm::vec2 Mesh::getUVCoordinates(glm::vec3 point) {
+	float length = glm::length(point);
+	if (length <= 0.0f) return glm::vec2(0.5f, 0.5f);
+	glm::vec3 direction = point / length;
+	float theta = atan2(-direction.z, direction.x);
+	float phi = asin(glm::clamp(direction.y, -1.0f, 1.0f));
+	return glm::vec2((theta + PI) / (2.0f * PI), phi / PI + 0.5f);
+}
+
+// Moller-Trumbore, both sides of the triangle count. u and v are the weights of the second and third vertex
+float Mesh::intersectTriangle(int index, const glm::vec3& origin, const glm::vec3& dir, float& u, float& v) const {
+	PROFILE_COUNT(COUNTER_TRIANGLE_TESTS);
+	const Triangle& triangle = triangles[index];
+	glm::vec3 p = glm::cross(dir, triangle.edge2);
+	float det = glm::dot(triangle.edge1, p);
+	// the ray runs parallel to the plane
+	if (det == 0.0f) return -1.0f;
+	float invDet = 1.0f / det;
+
+	glm::vec3 s = origin - triangle.v0;
+	u = glm::dot(s, p) * invDet;
+	if (u < 0.0f || u > 1.0f) return -1.0f;
+
+	glm::vec3 q = glm::cross(s, triangle.edge1);
+	v = glm::dot(dir, q) * invDet;
+	if (v < 0.0f || u + v > 1.0f) return -1.0f;
+
+	return glm::dot(triangle.edge2, q) * invDet;
+}
+
+int Mesh::closestTriangle(const glm::vec3& origin, const glm::vec3& dir, float tMin, float& tHit) const {
+	return bvh.intersectClosest(origin, dir, tMin, tHit, [&](int index) {
+		float u, v;
+		return intersectTriangle(index, origin, dir, u, v);
+	});
+}
+
+float Mesh::intersect(const glm::vec3& eyePoint, const glm::vec3& ray, const glm::mat4& inverseMatrix, float tMin) const {
+	glm::vec3 origin = glm::vec3(inverseMatrix * glm::vec4(eyePoint, 1.0f));
+	glm::vec3 dir = glm::vec3(inverseMatrix * glm::vec4(ray, 0.0f));
+	float tHit;
+	return closestTriangle(origin, dir, tMin, tHit) >= 0 ? tHit : -1.0f;
+}
+
+bool Mesh::occludes(const glm::vec3& eyePoint, const glm::vec3& ray, const glm::mat4& inverseMatrix, float tMin, float tMax) const {
+	glm::vec3 origin = glm::vec3(inverseMatrix * glm::vec4(eyePoint, 1.0f));
+	glm::vec3 dir = glm::vec3(inverseMatrix * glm::vec4(ray, 0.0f));
+	return bvh.intersectAny(origin, dir, tMax, [&](int index) {
+		float u, v;
+		float t = intersectTriangle(index, origin, dir, u, v);
+		return t > tMin && t < tMax;
+	}) >= 0;
+}
+
+// finds the hit again, only done once per shaded point so the walks stay free of normal work
+glm::vec3 Mesh::hitNormal(const glm::vec3& eyePoint, const glm::vec3& ray, const glm::mat4& inverseMatrix, const glm::mat3& normalMatrix, float tMin) const {
+	glm::vec3 origin = glm::vec3(inverseMatrix * glm::vec4(eyePoint, 1.0f));
+	glm::vec3 dir = glm::vec3(inverseMatrix * glm::vec4(ray, 0.0f));
+	float tHit;
+	int index = closestTriangle(origin, dir, tMin, tHit);
+	if (index < 0) return glm::vec3(0.0f);
+
+	float u, v;
+	intersectTriangle(index, origin, dir, u, v);
+	const Triangle& triangle = triangles[index];
+	glm::vec3 faceNormal = glm::cross(triangle.edge1, triangle.edge2);
+	glm::vec3 normal = (1.0f - u - v) * normals[indices[index * 3]] + u * normals[indices[index * 3 + 1]] + v * normals[indices[index * 3 + 2]];
+	if (glm::dot(normal, normal) == 0.0f) normal = faceNormal;
+
+	// PLY winding isn't reliable, so turn the normal towards the side the ray came from
+	if (glm::dot(faceNormal, dir) > 0.0f) normal = -normal;
+	return glm::normalize(normalMatrix * normal);
+}
@@ -0,0 +1,61 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <string>
+#include <vector>
+
+#include "Shape.h"
+#include "BVH.h"
+
+class ThreadPool;
+
+/* Triangle mesh read from a PLY file, scaled to fit the unit cube like the other
+   primitives. The triangles get a BVH of their own that is built once per file;
+   every object using the mesh shares it and only brings its transform, so the
+   scene BVH over objects and the mesh BVHs form a two level hierarchy. */
+class Mesh : public Shape {
+public:
+	Mesh();
+	~Mesh();
+
+	/* reads and triangulates fileName, then builds the triangle BVH. false if there are no
+	   triangles. pool, if there is one, parses large files in parallel */
+	bool load(const std::string& fileName, ThreadPool* pool = NULL);
+
+	int getTriangleCount() const { return (int)triangles.size(); }
+	// object space box around every triangle
+	const AABB& getBounds() const { return bounds; }
+
+	OBJ_TYPE getType() {
+		return SHAPE_MESH;
+	}
+	glm::vec2 getUVCoordinates(glm::vec3 point);
+
+	/* Like the other shapes the ray is moved into object space by inverseMatrix, so t
+	   is the same parameter in both spaces. Returns the t of the closest triangle hit
+	   after tMin or -1 on a miss. */
+	float intersect(const glm::vec3& eyePoint, const glm::vec3& ray, const glm::mat4& inverseMatrix, float tMin) const;
+	// true if any triangle is hit in (tMin, tMax), the walk stops at the first one
+	bool occludes(const glm::vec3& eyePoint, const glm::vec3& ray, const glm::mat4& inverseMatrix, float tMin, float tMax) const;
+	// world space normal at the closest hit, interpolated from the vertex normals and facing the ray
+	glm::vec3 hitNormal(const glm::vec3& eyePoint, const glm::vec3& ray, const glm::mat4& inverseMatrix, const glm::mat3& normalMatrix, float tMin) const;
+
+private:
+	// the first vertex and the two edges leaving it, all the ray test reads
+	struct Triangle {
+		glm::vec3 v0;
+		glm::vec3 edge1;
+		glm::vec3 edge2;
+	};
+
+	float intersectTriangle(int index, const glm::vec3& origin, const glm::vec3& dir, float& u, float& v) const;
+	int closestTriangle(const glm::vec3& origin, const glm::vec3& dir, float tMin, float& tHit) const;
+
+	std::vector<Triangle> triangles;
+	std::vector<int> indices;           // three vertex indices per triangle, for the normals
+	std::vector<glm::vec3> normals;     // per vertex, averaged over the faces around it
+	AABB bounds;
+	BVH bvh;
+};
+
+#endif
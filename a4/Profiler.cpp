@@ -0,0 +1,181 @@
+#include "Profiler.h"
+
+#include <vector>
+#include <map>
+#include <string>
+#include <mutex>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+// what one thread recorded since the last reset
+struct ProfileSlot {
+	long long counters[NUM_PROFILE_COUNTERS];
+	struct Scope {
+		const char* name;
+		Profiler::TimePoint start, end;
+	};
+	std::vector<Scope> scopes;
+	int id;
+};
+
+// a long session in the viewer would otherwise grow the scope list without bound
+static const size_t MAX_SCOPES_PER_THREAD = 1 << 20;
+
+static const char* COUNTER_NAMES[NUM_PROFILE_COUNTERS] = {
+	"primary rays",
+	"reflection rays",
+	"shadow rays",
+	"cube tests",
+	"cylinder tests",
+	"cone tests",
+	"sphere tests",
+	"torus tests",
+	"mesh tests",
+	"triangle tests",
+	"BVH nodes visited",
+	"texture lookups",
+	"texture cache misses",
+	"mesh cache misses",
+	"occluder cache hits",
+	"occluder cache misses",
+};
+
+static std::mutex slotLock;
+// slots outlive their threads, a pool that was replaced still shows up in the totals
+static std::vector<ProfileSlot*> slots;
+static Profiler::TimePoint epoch = std::chrono::steady_clock::now();
+static thread_local ProfileSlot* localSlot = NULL;
+
+static ProfileSlot* threadSlot() {
+	if (localSlot == NULL) {
+		ProfileSlot* slot = new ProfileSlot();
+		std::lock_guard<std::mutex> guard(slotLock);
+		slot->id = (int)slots.size();
+		slots.push_back(slot);
+		localSlot = slot;
+	}
+	return localSlot;
+}
+
+static double microseconds(Profiler::TimePoint time) {
+	return std::chrono::duration<double, std::micro>(time - epoch).count();
+}
+
+long long* Profiler::threadCounters() {
+	return threadSlot()->counters;
+}
+
+void Profiler::addScope(const char* name, TimePoint start, TimePoint end) {
+	ProfileSlot* slot = threadSlot();
+	if (slot->scopes.size() < MAX_SCOPES_PER_THREAD) {
+		ProfileSlot::Scope scope = { name, start, end };
+		slot->scopes.push_back(scope);
+	}
+}
+
+bool Profiler::enabled() {
+#ifdef RAYTRACER_PROFILE
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Profiler::reset() {
+	std::lock_guard<std::mutex> guard(slotLock);
+	for (size_t i = 0; i < slots.size(); i++) {
+		for (int c = 0; c < NUM_PROFILE_COUNTERS; c++) {
+			slots[i]->counters[c] = 0;
+		}
+		slots[i]->scopes.clear();
+	}
+	epoch = std::chrono::steady_clock::now();
+}
+
+void Profiler::collect(long long totals[NUM_PROFILE_COUNTERS]) {
+	std::lock_guard<std::mutex> guard(slotLock);
+	for (int c = 0; c < NUM_PROFILE_COUNTERS; c++) {
+		totals[c] = 0;
+		for (size_t i = 0; i < slots.size(); i++) {
+			totals[c] += slots[i]->counters[c];
+		}
+	}
+}
+
+const char* Profiler::counterName(int counter) {
+	return (counter >= 0 && counter < NUM_PROFILE_COUNTERS) ? COUNTER_NAMES[counter] : "";
+}
+
+void Profiler::printSummary(FILE* out) {
+	if (!enabled()) {
+		fprintf(out, "profiling is not compiled in, build with make PROFILE=1\n");
+		return;
+	}
+	long long totals[NUM_PROFILE_COUNTERS];
+	collect(totals);
+	fprintf(out, "\n%-24s %16s\n", "counter", "total");
+	for (int c = 0; c < NUM_PROFILE_COUNTERS; c++) {
+		fprintf(out, "%-24s %16lld\n", COUNTER_NAMES[c], totals[c]);
+	}
+
+	// scopes of the same name are summed over all threads, so trace and shade add up to thread time
+	struct ScopeTotal {
+		long long count;
+		double microseconds;
+	};
+	std::map<std::string, ScopeTotal> scopeTotals;
+	{
+		std::lock_guard<std::mutex> guard(slotLock);
+		for (size_t i = 0; i < slots.size(); i++) {
+			for (size_t s = 0; s < slots[i]->scopes.size(); s++) {
+				const ProfileSlot::Scope& scope = slots[i]->scopes[s];
+				ScopeTotal& total = scopeTotals[scope.name];
+				total.count++;
+				total.microseconds += std::chrono::duration<double, std::micro>(scope.end - scope.start).count();
+			}
+		}
+	}
+	fprintf(out, "\n%-24s %10s %12s %12s\n", "scope", "count", "total ms", "mean us");
+	for (auto& it : scopeTotals) {
+		fprintf(out, "%-24s %10lld %12.2f %12.2f\n", it.first.c_str(), it.second.count, it.second.microseconds / 1000.0, it.second.microseconds / it.second.count);
+	}
+}
+
+bool Profiler::writeChromeTrace(const char* fileName) {
+	std::ofstream out(fileName);
+	if (!out.is_open()) {
+		printf("Unable to write %s\n", fileName);
+		return false;
+	}
+	long long totals[NUM_PROFILE_COUNTERS];
+	collect(totals);
+
+	std::lock_guard<std::mutex> guard(slotLock);
+	// timestamps are in microseconds, keep them to the nanosecond
+	out << std::fixed << std::setprecision(3);
+	out << "{\"traceEvents\": [\n";
+	bool first = true;
+	double last = 0.0;
+	for (size_t i = 0; i < slots.size(); i++) {
+		const ProfileSlot* slot = slots[i];
+		if (slot->scopes.empty()) continue;
+		out << (first ? "" : ",\n");
+		out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << slot->id << ", \"args\": {\"name\": \"thread " << slot->id << "\"}}";
+		first = false;
+		for (size_t s = 0; s < slot->scopes.size(); s++) {
+			const ProfileSlot::Scope& scope = slot->scopes[s];
+			double start = microseconds(scope.start);
+			double end = microseconds(scope.end);
+			last = std::max(last, end);
+			out << ",\n{\"name\": \"" << scope.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << slot->id << ", \"ts\": " << start << ", \"dur\": " << end - start << "}";
+		}
+	}
+	// the totals once at the end, as a counter track
+	out << (first ? "" : ",\n") << "{\"name\": \"counters\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << last << ", \"args\": {";
+	for (int c = 0; c < NUM_PROFILE_COUNTERS; c++) {
+		out << (c > 0 ? ", " : "") << "\"" << COUNTER_NAMES[c] << "\": " << totals[c];
+	}
+	out << "}}\n]}\n";
+	return true;
+}
@@ -0,0 +1,80 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdio>
+#include <chrono>
+
+/* Counters and scoped timers for finding out where a frame's time goes. They are
+   only compiled in with -DRAYTRACER_PROFILE (make PROFILE=1); without it the
+   PROFILE_ macros expand to nothing and the hot loops carry no trace of them.
+
+   Every thread counts into its own slot, so counting is a plain increment. The
+   slots are summed up, written out or reset between frames, while no render
+   threads are running. */
+
+enum ProfileCounter {
+	COUNTER_PRIMARY_RAYS,
+	COUNTER_REFLECTION_RAYS,
+	COUNTER_SHADOW_RAYS,
+	COUNTER_CUBE_TESTS,         // ray-object tests by the type of the object, packets count every lane
+	COUNTER_CYLINDER_TESTS,
+	COUNTER_CONE_TESTS,
+	COUNTER_SPHERE_TESTS,
+	COUNTER_TORUS_TESTS,
+	COUNTER_MESH_TESTS,
+	COUNTER_TRIANGLE_TESTS,
+	COUNTER_BVH_NODES,          // nodes popped off the traversal stack, scene and mesh BVHs alike
+	COUNTER_TEXTURE_LOOKUPS,
+	COUNTER_TEXTURE_CACHE_MISSES,   // texture files read because they weren't cached yet
+	COUNTER_MESH_CACHE_MISSES,
+	COUNTER_OCCLUDER_CACHE_HITS,    // shadow rays stopped by the last blocker of their light
+	COUNTER_OCCLUDER_CACHE_MISSES,
+	NUM_PROFILE_COUNTERS
+};
+
+class Profiler {
+public:
+	typedef std::chrono::steady_clock::time_point TimePoint;
+
+	// zeroes every counter and drops the recorded scopes, their times start over from now
+	static void reset();
+	// totals over all threads
+	static void collect(long long totals[NUM_PROFILE_COUNTERS]);
+	static const char* counterName(int counter);
+
+	// counter and scope totals as a table
+	static void printSummary(FILE* out);
+	// every recorded scope as a Chrome trace (chrome://tracing, Perfetto), the counter totals go in as metadata
+	static bool writeChromeTrace(const char* fileName);
+
+	// true if the profiler was compiled in
+	static bool enabled();
+
+	// used by the macros below
+	static long long* threadCounters();
+	static void addScope(const char* name, TimePoint start, TimePoint end);
+};
+
+// times the rest of the enclosing block as one event named name (a string literal)
+class ProfileScope {
+public:
+	ProfileScope(const char* name) : name(name), start(std::chrono::steady_clock::now()) {}
+	~ProfileScope() { Profiler::addScope(name, start, std::chrono::steady_clock::now()); }
+
+private:
+	const char* name;
+	Profiler::TimePoint start;
+};
+
+#ifdef RAYTRACER_PROFILE
+#define PROFILE_COUNT_N(counter, n) (Profiler::threadCounters()[counter] += (n))
+#define PROFILE_SCOPE_JOIN(name, line) ProfileScope profileScope##line(name)
+#define PROFILE_SCOPE_LINE(name, line) PROFILE_SCOPE_JOIN(name, line)
+#define PROFILE_SCOPE(name) PROFILE_SCOPE_LINE(name, __LINE__)
+#else
+#define PROFILE_COUNT_N(counter, n) ((void)0)
+#define PROFILE_SCOPE(name) ((void)0)
+#endif
+#define PROFILE_COUNT(counter) PROFILE_COUNT_N(counter, 1)
+
+#endif
@@ -0,0 +1,135 @@
+#include "ProgressiveRenderer.h"
+
+#include <cstring>
+
+ProgressiveRenderer::ProgressiveRenderer(RayTracer* rayTracer) {
+	this->rayTracer = rayTracer;
+	hasPendingJob = false;
+	scenePrepared = false;
+	stopping = false;
+	busy = false;
+	cancelRequested = false;
+	frameWidth = frameHeight = 0;
+	frameStep = 0;
+	renderThread = std::thread(&ProgressiveRenderer::threadLoop, this);
+}
+
+ProgressiveRenderer::~ProgressiveRenderer() {
+	{
+		std::lock_guard<std::mutex> guard(stateLock);
+		stopping = true;
+		hasPendingJob = false;
+		cancelRequested = true;
+	}
+	wakeCondition.notify_all();
+	renderThread.join();
+}
+
+void ProgressiveRenderer::start(const Camera& camera, int width, int height, int recurseDepth, bool isectOnly) {
+	if (width <= 0 || height <= 0) return;
+	{
+		std::lock_guard<std::mutex> guard(stateLock);
+		pendingJob.camera = camera;
+		pendingJob.width = width;
+		pendingJob.height = height;
+		pendingJob.recurseDepth = recurseDepth;
+		pendingJob.isectOnly = isectOnly;
+		hasPendingJob = true;
+		// the pass in flight gives up at its next row, the thread then picks up this job
+		cancelRequested = true;
+	}
+	wakeCondition.notify_all();
+}
+
+void ProgressiveRenderer::stop() {
+	std::unique_lock<std::mutex> guard(stateLock);
+	hasPendingJob = false;
+	cancelRequested = true;
+	idleCondition.wait(guard, [this]() { return !busy; });
+}
+
+void ProgressiveRenderer::sceneChanged() {
+	std::lock_guard<std::mutex> guard(stateLock);
+	scenePrepared = false;
+}
+
+int ProgressiveRenderer::copyFrame(unsigned char* pixels, int width, int height) {
+	std::lock_guard<std::mutex> guard(frameLock);
+	if (frameStep == 0 || width != frameWidth || height != frameHeight) return 0;
+	memcpy(pixels, &frame[0], frame.size());
+	return frameStep;
+}
+
+bool ProgressiveRenderer::copyHeatmap(unsigned char* pixels, int width, int height) {
+	std::lock_guard<std::mutex> guard(frameLock);
+	if (heatmap.empty() || width != frameWidth || height != frameHeight) return false;
+	memcpy(pixels, &heatmap[0], heatmap.size());
+	return true;
+}
+
+void ProgressiveRenderer::setPassCallback(const std::function<void(int)>& callback) {
+	std::lock_guard<std::mutex> guard(stateLock);
+	passCallback = callback;
+}
+
+void ProgressiveRenderer::threadLoop() {
+	std::unique_lock<std::mutex> guard(stateLock);
+	while (true) {
+		wakeCondition.wait(guard, [this]() { return stopping || hasPendingJob; });
+		if (stopping) return;
+
+		Job job = pendingJob;
+		hasPendingJob = false;
+		cancelRequested = false;
+		bool prepare = !scenePrepared;
+		scenePrepared = true;
+		std::function<void(int)> callback = passCallback;
+		busy = true;
+		guard.unlock();
+
+		if (prepare) {
+			rayTracer->prepareScene();
+		}
+		// passes build on each other in this buffer, the frame only ever sees finished ones
+		std::vector<unsigned char> buffer(job.width * job.height * 3);
+		bool finished = true;
+		for (int step = COARSE_STEP; step >= 1 && finished; step /= 2) {
+			bool refine = step != COARSE_STEP;
+			finished = rayTracer->renderPass(&job.camera, &buffer[0], job.width, job.height, job.recurseDepth, job.isectOnly, step, refine, &cancelRequested);
+			if (finished) {
+				publishFrame(buffer, job, step, callback);
+			}
+		}
+		// antialiasing refines the one ray per pixel image in place, it replaces it as step 1
+		if (finished && rayTracer->getMaxSamples() > 1 && rayTracer->antialiasPass(&cancelRequested)) {
+			std::vector<unsigned char> samples(buffer.size());
+			rayTracer->sampleHeatmap(&samples[0]);
+			{
+				std::lock_guard<std::mutex> frameGuard(frameLock);
+				heatmap.swap(samples);
+			}
+			publishFrame(buffer, job, 1, callback);
+		}
+
+		guard.lock();
+		busy = false;
+		idleCondition.notify_all();
+	}
+}
+
+void ProgressiveRenderer::publishFrame(const std::vector<unsigned char>& buffer, const Job& job, int step, const std::function<void(int)>& callback) {
+	{
+		std::lock_guard<std::mutex> frameGuard(frameLock);
+		frame = buffer;
+		frameWidth = job.width;
+		frameHeight = job.height;
+		frameStep = step;
+		// a new frame, the heatmap of the one before no longer fits it
+		if (step == COARSE_STEP) {
+			heatmap.clear();
+		}
+	}
+	if (callback) {
+		callback(step);
+	}
+}
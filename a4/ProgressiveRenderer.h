@@ -0,0 +1,74 @@
+#ifndef PROGRESSIVERENDERER_H
+#define PROGRESSIVERENDERER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "RayTracer.h"
+
+/* Renders on a background thread so the UI stays responsive. Every frame starts
+   with a pass at 1/COARSE_STEP resolution and is refined by passes of half the
+   step down to one ray per pixel, followed by the ray tracer's antialiasing pass if
+   it has a sample budget; the result of each finished pass can be picked up with
+   copyFrame(). start() cancels whatever is being traced and begins again
+   with the new settings. */
+class ProgressiveRenderer {
+public:
+	static const int COARSE_STEP = 8;
+
+	ProgressiveRenderer(RayTracer* rayTracer);
+	~ProgressiveRenderer();
+
+	// restarts rendering with a copy of camera, rebuilding the scene first if it changed
+	void start(const Camera& camera, int width, int height, int recurseDepth, bool isectOnly);
+	// cancels and waits for the render thread to go idle, the ray tracer can be changed after this
+	void stop();
+	// the scene file or its contents changed (after a stop()), the next start() runs prepareScene() for it
+	void sceneChanged();
+
+	/* Copies the latest finished pass into pixels if it is width x height, returns the
+	   step of that pass (1 = final image) or 0 if there is nothing of that size yet. */
+	int copyFrame(unsigned char* pixels, int width, int height);
+	// the same for the samples per pixel heatmap of the antialiased frame, false until there is one
+	bool copyHeatmap(unsigned char* pixels, int width, int height);
+	// called on the render thread after every finished pass with its step
+	void setPassCallback(const std::function<void(int)>& callback);
+
+private:
+	struct Job {
+		Camera camera;
+		int width, height;
+		int recurseDepth;
+		bool isectOnly;
+	};
+
+	void threadLoop();
+	void publishFrame(const std::vector<unsigned char>& buffer, const Job& job, int step, const std::function<void(int)>& callback);
+
+	RayTracer* rayTracer;
+	std::thread renderThread;
+
+	std::mutex stateLock;               // guards everything down to busy
+	std::condition_variable wakeCondition;
+	std::condition_variable idleCondition;
+	Job pendingJob;
+	bool hasPendingJob;
+	bool scenePrepared;
+	bool stopping;
+	bool busy;
+	std::atomic<bool> cancelRequested;
+
+	std::mutex frameLock;               // guards the finished frame
+	std::vector<unsigned char> frame;
+	std::vector<unsigned char> heatmap;
+	int frameWidth, frameHeight;
+	int frameStep;
+
+	std::function<void(int)> passCallback;
+};
+
+#endif
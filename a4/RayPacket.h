@@ -0,0 +1,46 @@
+#ifndef RAYPACKET_H
+#define RAYPACKET_H
+
+#include <glm/glm.hpp>
+
+// rays per packet used by the renderer, a TILE_SIZE row splits into whole packets
+#define PACKET_SIZE 8
+
+/* N rays stored structure of arrays, one array per component, so the packet
+   kernels in the shapes run the same arithmetic on every lane and the compiler
+   can keep each lane in its own SSE/AVX/NEON slot. The kernels are written with
+   selects instead of branches and work for any N (4, 8 and 16 are used). */
+template <int N>
+struct RayPacket {
+	float ox[N], oy[N], oz[N];     // origins
+	float dx[N], dy[N], dz[N];     // directions, not normalized
+
+	void set(int lane, const glm::vec3& origin, const glm::vec3& dir) {
+		ox[lane] = origin.x; oy[lane] = origin.y; oz[lane] = origin.z;
+		dx[lane] = dir.x; dy[lane] = dir.y; dz[lane] = dir.z;
+	}
+	glm::vec3 origin(int lane) const { return glm::vec3(ox[lane], oy[lane], oz[lane]); }
+	glm::vec3 dir(int lane) const { return glm::vec3(dx[lane], dy[lane], dz[lane]); }
+};
+
+/* A packet moved into an object's space by inverseMatrix. Sums are grouped like
+   glm's mat4 * vec4 so every lane gets bit for bit the same P and d as the scalar
+   intersect() functions. */
+template <int N>
+struct ObjectSpacePacket {
+	float Px[N], Py[N], Pz[N];
+	float dx[N], dy[N], dz[N];
+
+	ObjectSpacePacket(const RayPacket<N>& rays, const glm::mat4& m) {
+		for (int i = 0; i < N; i++) {
+			Px[i] = (m[0][0] * rays.ox[i] + m[1][0] * rays.oy[i]) + (m[2][0] * rays.oz[i] + m[3][0]);
+			Py[i] = (m[0][1] * rays.ox[i] + m[1][1] * rays.oy[i]) + (m[2][1] * rays.oz[i] + m[3][1]);
+			Pz[i] = (m[0][2] * rays.ox[i] + m[1][2] * rays.oy[i]) + (m[2][2] * rays.oz[i] + m[3][2]);
+			dx[i] = (m[0][0] * rays.dx[i] + m[1][0] * rays.dy[i]) + (m[2][0] * rays.dz[i] + m[3][0] * 0.0f);
+			dy[i] = (m[0][1] * rays.dx[i] + m[1][1] * rays.dy[i]) + (m[2][1] * rays.dz[i] + m[3][1] * 0.0f);
+			dz[i] = (m[0][2] * rays.dx[i] + m[1][2] * rays.dy[i]) + (m[2][2] * rays.dz[i] + m[3][2] * 0.0f);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,1438 @@
+#include "RayTracer.h"
+#include "math.h"
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+int Shape::m_segmentsX;
+int Shape::m_segmentsY;
+const float INTERSECTION_EPSILON = 1e-3f; 
+const float SHADOW_EPSILON = INTERSECTION_EPSILON * 2; 
+const int TILE_SIZE = 16;
+// neighbours or samples further apart than this in any channel make a pixel worth more samples
+const float CONTRAST_THRESHOLD = 0.1f;
+const int MAX_SAMPLES = 64;
+// below half a byte of color a light isn't worth its shadow rays
+const float LIGHT_CULL_THRESHOLD = 0.5f / 255.0f;
+// reflections weighted less than half a byte end the path
+const float REFLECTION_CUTOFF = 0.5f / 255.0f;
+// paths weaker than this play Russian roulette when it is on
+const float ROULETTE_START = 0.1f;
+
+RayTracer::RayTracer() {
+	parser = NULL;
+
+	cube = new Cube();
+	cylinder = new Cylinder();
+	cone = new Cone();
+	sphere = new Sphere();
+	torus = new Torus();
+
+	numThreads = 0;
+	threadPool = NULL;
+	sceneDirty = true;
+	updatedObjects = 0;
+
+	camera = NULL;
+	pixels = NULL;
+	pixelWidth = pixelHeight = 0;
+	recurseDepth = 0;
+	isectOnly = false;
+	passStep = 1;
+	refinePass = false;
+	cancelFlag = NULL;
+	pixelSpread = 0.0f;
+	maxSamples = 1;
+	lightGrid = 4;
+	russianRoulette = false;
+	lensSamples = 16;
+	lensPackets = false;
+	autoFocus = false;
+}
+
+RayTracer::~RayTracer() {
+	delete cube;
+	delete cylinder;
+	delete cone;
+	delete sphere;
+	delete torus;
+	if (parser != NULL) {
+		delete parser;
+	}
+	if (threadPool != NULL) {
+		delete threadPool;
+	}
+	for (auto& it : meshCache) {
+		delete it.second;
+	}
+}
+
+float blendHelper(float original, float textureValue, float blend) {
+	return (1 - blend) * original + (blend * textureValue);
+}
+
+// maps a primitive type to the shared shape that intersects it. The shapes hold no
+// per-ray state so the render threads can all use them at once.
+Shape* RayTracer::getShape(OBJ_TYPE type) {
+	switch (type) {
+	case SHAPE_CUBE:
+		return cube;
+	case SHAPE_CYLINDER:
+		return cylinder;
+	case SHAPE_CONE:
+		return cone;
+	case SHAPE_SPHERE:
+		return sphere;
+	case SHAPE_SPECIAL1:
+		return torus;
+	default:
+		return cube;
+	}
+}
+
+// called from the render threads, so it must not keep any per-ray state
+float RayTracer::renderShape(OBJ_TYPE type, glm::vec3 ray, const glm::mat4& inverseMatrix, glm::vec3 eyePoint) {
+	return getShape(type)->draw(eyePoint, ray, inverseMatrix);
+}
+
+bool RayTracer::loadSceneFile(const char* filenamePath) {
+	PROFILE_SCOPE("parse");
+	if (parser != nullptr) {
+		delete parser;
+		parser = nullptr;
+	}
+
+	sceneObjects.clear();
+	bvh.clear();
+	// the nodes these point at went with the old parser
+	sceneDirty = true;
+	flattenedNodes.clear();
+	nodeVisits.clear();
+	materialIndices.clear();
+	changedNodes.clear();
+	changedPrimitives.clear();
+
+	parser = new SceneParser(filenamePath);
+
+	bool success = parser->parse();
+	cout << "success? " << success << endl;
+	if (success == false) {
+		delete parser;
+		parser = NULL;
+	}
+	else {
+		parser->getGlobalData(globalSceneData);
+	}
+	return success;
+}
+
+void RayTracer::setupCamera(Camera* camera) {
+	if (parser == NULL) {
+		return;
+	}
+	SceneCameraData cameraData;
+	parser->getCameraData(cameraData);
+	camera->reset();
+	camera->setViewAngle(cameraData.heightAngle);
+	camera->setAperture(cameraData.aperture);
+	/* Without a focal length the look at point is in focus. A look vector is only a
+	   direction, so then renderPass focuses on the first hit along the view ray. */
+	float focalDistance = cameraData.focalLength;
+	autoFocus = focalDistance <= 0.0f && cameraData.isDir;
+	if (focalDistance <= 0.0f && !cameraData.isDir) {
+		focalDistance = glm::distance(cameraData.pos, cameraData.lookAt);
+	}
+	camera->setFocalDistance(focalDistance);
+	if (cameraData.isDir == true) {
+		camera->orientLookVec(cameraData.pos, cameraData.look, cameraData.up);
+	}
+	else {
+		camera->orientLookAt(cameraData.pos, cameraData.lookAt, cameraData.up);
+	}
+}
+
+// parentTransform followed by the transformations of node, in the order they are listed
+static glm::mat4 nodeTransform(const SceneNode* node, const glm::mat4& parentTransform)
+{
+	glm::mat4 currentTransform = parentTransform;
+	for (const auto& transform : node->transformations)
+	{
+		switch (transform->type)
+		{
+		case TRANSFORMATION_TRANSLATE:
+			currentTransform = glm::translate(currentTransform, transform->translate);
+			break;
+		case TRANSFORMATION_SCALE:
+			currentTransform = glm::scale(currentTransform, transform->scale);
+			break;
+		case TRANSFORMATION_ROTATE:
+			currentTransform = glm::rotate(currentTransform, transform->angle, transform->rotate);
+			break;
+		case TRANSFORMATION_MATRIX:
+			currentTransform = currentTransform * transform->matrix;
+			break;
+		}
+	}
+	return currentTransform;
+}
+
+void RayTracer::traverseSceneGraph(SceneNode* node, const glm::mat4& parentTransform)
+{
+	if (!node) return;
+
+	glm::mat4 currentTransform = nodeTransform(node, parentTransform);
+
+	// remember where this visit's objects went, so an edit can rewrite just them
+	int visit = (int)flattenedNodes.size();
+	FlattenedNode flat = { node, parentTransform, (int)sceneObjects.size(), 0, (int)node->primitives.size(), (int)node->children.size() };
+	flattenedNodes.push_back(flat);
+	nodeVisits[node].push_back(visit);
+
+	// add each primitive and computed transforms to sceneObjects, inverting once here
+	// instead of once per ray in every intersection test
+	glm::mat4 inverseTransform = glm::inverse(currentTransform);
+	glm::mat3 normalMatrix = glm::transpose(glm::mat3(inverseTransform));
+	for (const auto& primitive : node->primitives) {
+		sceneObjects.push_back({
+			currentTransform,
+			inverseTransform,
+			normalMatrix,
+			primitive // point
+		});
+	}
+
+	// clear primitive pointers from node to prevent double deletion
+	//node->primitives.clear();
+
+	// recursively traverse children nodes
+	for (SceneNode* child : node->children)
+	{
+		traverseSceneGraph(child, currentTransform);
+	}
+	flattenedNodes[visit].visitEnd = (int)flattenedNodes.size();
+}
+
+/* Writes the transforms of an already flattened subtree again, visiting it in the
+   same order traverseSceneGraph() did so every object lands where it was. Returns
+   false if the subtree no longer has the shape it was flattened with. */
+bool RayTracer::reflattenSubtree(int visit, const glm::mat4& parentTransform, std::vector<int>& changed)
+{
+	FlattenedNode& flat = flattenedNodes[visit];
+	const SceneNode* node = flat.node;
+	if ((int)node->primitives.size() != flat.primitiveCount || (int)node->children.size() != flat.childCount) {
+		return false;
+	}
+	flat.parentTransform = parentTransform;
+	glm::mat4 currentTransform = nodeTransform(node, parentTransform);
+	glm::mat4 inverseTransform = glm::inverse(currentTransform);
+	glm::mat3 normalMatrix = glm::transpose(glm::mat3(inverseTransform));
+	for (int p = 0; p < flat.primitiveCount; p++) {
+		int object = flat.firstObject + p;
+		SceneObject& obj = sceneObjects[object];
+		if (obj.primitive != node->primitives[p]) {
+			return false;
+		}
+		obj.transformMatrix = currentTransform;
+		obj.inverseTransformMatrix = inverseTransform;
+		obj.normalMatrix = normalMatrix;
+		changed.push_back(object);
+	}
+
+	int child = visit + 1;
+	for (int c = 0; c < flat.childCount; c++) {
+		if (flattenedNodes[child].node != node->children[c] || !reflattenSubtree(child, currentTransform, changed)) {
+			return false;
+		}
+		child = flattenedNodes[child].visitEnd;
+	}
+	return true;
+}
+
+void RayTracer::nodeChanged(SceneNode* node) {
+	if (node != NULL && !node->dirty) {
+		node->dirty = true;
+		changedNodes.push_back(node);
+	}
+}
+
+void RayTracer::primitiveChanged(ScenePrimitive* primitive) {
+	if (primitive != NULL && !primitive->dirty) {
+		primitive->dirty = true;
+		changedPrimitives.push_back(primitive);
+	}
+}
+
+void RayTracer::clearChanges() {
+	for (SceneNode* node : changedNodes) {
+		node->dirty = false;
+	}
+	for (ScenePrimitive* primitive : changedPrimitives) {
+		primitive->dirty = false;
+	}
+	changedNodes.clear();
+	changedPrimitives.clear();
+}
+
+/* Catches the flattened scene, the BVH and the compiled scene up with the nodes and
+   primitives marked changed since the last prepareScene(). Objects below a changed
+   node get new transforms and boxes and the BVH is refit around them. Returns false
+   if that isn't possible or not worth it and everything has to be redone. */
+bool RayTracer::updateScene()
+{
+	if (changedNodes.empty() && changedPrimitives.empty()) {
+		return true;
+	}
+	PROFILE_SCOPE("update scene");
+
+	std::vector<int> changed;
+	for (SceneNode* node : changedNodes) {
+		auto visits = nodeVisits.find(node);
+		// not reached from the root, so it can't move anything
+		if (visits == nodeVisits.end()) continue;
+		for (int visit : visits->second) {
+			if (!reflattenSubtree(visit, flattenedNodes[visit].parentTransform, changed)) {
+				return false;
+			}
+		}
+	}
+	// a node marked together with one above it was written twice
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+	// past half the scene a new tree costs about as much and traces faster than a refit one
+	if (changed.size() * 2 > sceneObjects.size()) {
+		return false;
+	}
+
+	for (int object : changed) {
+		const SceneObject& obj = sceneObjects[object];
+		objectBounds[object] = getWorldBounds(obj);
+		PrimitiveRecord& record = compiledScene.primitives(compiledScene.objectTypes[object])[compiledScene.objectSlots[object]];
+		record.inverseTransformMatrix = obj.inverseTransformMatrix;
+		record.normalMatrix = obj.normalMatrix;
+	}
+	bvh.refit(changed, objectBounds);
+
+	for (ScenePrimitive* primitive : changedPrimitives) {
+		auto found = materialIndices.find(primitive);
+		if (found == materialIndices.end()) continue;
+		if (primitive->material.textureMap->isUsed) {
+			textureStore.load(primitive->material.textureMap->filename);
+		}
+		compiledScene.materials[found->second] = compileMaterial(primitive->material);
+	}
+
+	updatedObjects = (int)changed.size();
+	clearChanges();
+	return true;
+}
+//Given the pixel (x, y) position, set its color to (r, g, b)
+void RayTracer::setpixel(unsigned char* buf, int x, int y, int r, int g, int b) {
+	int width = pixelWidth;
+	buf[(y*width + x) * 3 + 0] = (unsigned char)r;
+	buf[(y*width + x) * 3 + 1] = (unsigned char)g;
+	buf[(y*width + x) * 3 + 2] = (unsigned char)b;
+}
+// direct light at a hit for all three channels, each light's shadow ray is traced once
+glm::vec3 RayTracer::calculateObjectLighting(const MaterialRecord& material, glm::vec3 objNormal, glm::vec3 worldSpacePos, glm::vec3 textureMap, glm::vec3 viewOrigin, ThreadContext& context) {
+    // shadowed areas only get the unblended ambient term
+    glm::vec3 ambient = globalSceneData.ka * material.ambient;
+    glm::vec3 intensity = ambient;
+    // in non-shadow areas ambient and diffuse are blended with the texture
+    glm::vec3 blendedValue(
+        blendHelper(ambient.r + globalSceneData.kd * material.diffuse.r, textureMap.x, material.blend),
+        blendHelper(ambient.g + globalSceneData.kd * material.diffuse.g, textureMap.y, material.blend),
+        blendHelper(ambient.b + globalSceneData.kd * material.diffuse.b, textureMap.z, material.blend));
+    glm::vec3 normal = glm::normalize(objNormal);
+    glm::vec3 viewVector = glm::normalize(viewOrigin - worldSpacePos);
+
+    for (size_t i = 0; i < compiledScene.lights.size(); i++) {
+        const LightRecord& light = compiledScene.lights[i];
+        // lights too dim or too far off their cone to change a byte of the pixel cost no shadow rays
+        float cone = spotFactor(light, worldSpacePos);
+        glm::vec3 reach = light.color * cone * maxAttenuation(light, worldSpacePos);
+        if (std::max(reach.r, std::max(reach.g, reach.b)) < LIGHT_CULL_THRESHOLD) {
+            context.stats.culledLights++;
+            continue;
+        }
+
+        // lights with an area are sampled on an n x n grid over it, all others (and every light
+        // when the budget is one ray) with one ray to their center
+        bool soft = light.hasExtent && lightGrid > 1;
+        int count = soft ? lightGrid * lightGrid : 1;
+        glm::vec3 diffuse(0.0f);
+        glm::vec3 specular(0.0f);
+        float seen = 0.0f;
+        int visible = 0;
+        int taken = 0;
+        for (int k = 0; k < count; k++) {
+            // four samples that all agree mean the point is fully lit or fully in shadow
+            if (k == 4 && (visible == 0 || visible == 4)) break;
+            taken++;
+
+            glm::vec3 normLightVector;
+            float lightDistance;
+            float weight = cone;
+            if (light.type == LIGHT_DIRECTIONAL) {
+                normLightVector = light.direction;
+                lightDistance = std::numeric_limits<float>::max();
+            } else {
+                glm::vec3 lightPoint = soft ? emitterPoint(light, k, worldSpacePos) : light.position;
+                normLightVector = glm::normalize(lightPoint - worldSpacePos);
+                lightDistance = glm::length(lightPoint - worldSpacePos);
+                weight *= attenuation(light, lightDistance);
+                // area lights only shine from their front, and less so at grazing angles
+                if (light.type == LIGHT_AREA) {
+                    weight *= glm::dot(normLightVector, light.direction);
+                    if (weight <= 0.0f) continue;
+                }
+            }
+
+            glm::vec3 shadowRayOrigin = worldSpacePos + SHADOW_EPSILON * normLightVector;
+            if (isInShadow(shadowRayOrigin, normLightVector, lightDistance, (int)i, context)) {
+                continue;
+            }
+            visible++;
+            seen += std::min(weight, 1.0f);
+
+            float nDotL = glm::max(glm::dot(normal, normLightVector), 0.0f);
+            diffuse += (blendedValue * nDotL) * weight;
+
+            // specular term (unblended), seen from viewOrigin rather than the camera
+            glm::vec3 reflectVector = glm::normalize(glm::reflect(-normLightVector, objNormal));
+            float rDotV = glm::max(glm::dot(reflectVector, viewVector), 0.0f);
+            float shine = pow(rDotV, material.shininess);
+            specular += (globalSceneData.ks * material.specular * shine) * weight;
+        }
+        if (visible == 0) {
+            continue;
+        }
+
+        // first remove the base ambient of the shadow case, as far as the light reaches the point.
+        // A light too dim to see thereby leaves the point as it was, which is what makes culling safe
+        intensity -= ambient * (seen / taken);
+        intensity += light.color * (diffuse / (float)taken);
+        intensity += light.color * (specular / (float)taken);
+    }
+
+    return glm::clamp(intensity, 0.0f, 1.0f);
+}
+
+// 1 / (x + y d + z d^2) of the light's function, lights without a usable one don't fade
+float RayTracer::attenuation(const LightRecord& light, float distance) {
+    float denominator = light.function.x + distance * (light.function.y + distance * light.function.z);
+    return denominator > 0.0f ? 1.0f / denominator : 1.0f;
+}
+
+// the strongest attenuation any point of the emitter can have at point
+float RayTracer::maxAttenuation(const LightRecord& light, const glm::vec3& point) {
+    if (light.type == LIGHT_DIRECTIONAL) {
+        return 1.0f;
+    }
+    glm::vec3 offset = point - light.position;
+    if (light.type == LIGHT_AREA && glm::dot(offset, light.direction) >= 0.0f) {
+        // behind the area light
+        return 0.0f;
+    }
+    float extent = glm::length(light.axisU + light.axisV);
+    return attenuation(light, std::max(glm::length(offset) - extent, 0.0f));
+}
+
+// smooth falloff across the spot's penumbra, 1 for every other type of light
+float RayTracer::spotFactor(const LightRecord& light, const glm::vec3& point) {
+    if (light.type != LIGHT_SPOT || light.cosOuter <= -1.0f) {
+        return 1.0f;
+    }
+    glm::vec3 offset = point - light.position;
+    float length = glm::length(offset);
+    if (length == 0.0f) {
+        return 1.0f;
+    }
+    float cosAngle = glm::dot(offset / length, -light.direction);
+    if (cosAngle <= light.cosOuter) return 0.0f;
+    if (cosAngle >= light.cosInner) return 1.0f;
+    float x = (cosAngle - light.cosOuter) / (light.cosInner - light.cosOuter);
+    return x * x * (3.0f - 2.0f * x);
+}
+
+/* Sample k of the lightGrid x lightGrid strata over the emitter, jittered by a hash of
+   the shaded point so the result doesn't depend on which thread shades it. k walks the
+   cells in bit reversed Morton order, so the first four land in different quadrants. */
+glm::vec3 RayTracer::emitterPoint(const LightRecord& light, int k, const glm::vec3& point) {
+    int bits = 0;
+    while ((1 << bits) < lightGrid) bits++;
+    int morton = 0;
+    for (int b = 0; b < 2 * bits; b++) {
+        if (k & (1 << b)) morton |= 1 << (2 * bits - 1 - b);
+    }
+    int cellX = 0, cellY = 0;
+    for (int b = 0; b < bits; b++) {
+        cellX |= ((morton >> (2 * b)) & 1) << b;
+        cellY |= ((morton >> (2 * b + 1)) & 1) << b;
+    }
+
+    unsigned int h;
+    unsigned int coordinates[3];
+    memcpy(coordinates, &point, sizeof(coordinates));
+    h = coordinates[0] * 73856093u ^ coordinates[1] * 19349663u ^ coordinates[2] * 83492791u ^ (unsigned int)k * 2654435761u;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    float u = (cellX + (h & 0xffff) / 65536.0f) / lightGrid;
+    float v = (cellY + (h >> 16) / 65536.0f) / lightGrid;
+
+    if (light.type == LIGHT_AREA) {
+        return light.position + (2.0f * u - 1.0f) * light.axisU + (2.0f * v - 1.0f) * light.axisV;
+    }
+    // the square maps onto the spot's disk, equal areas to equal areas
+    float radius = sqrt(u);
+    float angle = 2.0f * PI * v;
+    return light.position + radius * (cos(angle) * light.axisU + sin(angle) * light.axisV);
+}
+
+bool RayTracer::isInShadow(const glm::vec3& point, const glm::vec3& lightDir, float lightDistance, int lightIndex, ThreadContext& context) {
+	glm::vec3 shadowRayOrigin = point + SHADOW_EPSILON * lightDir; // Offset to prevent self-intersection
+	context.stats.shadowRays++;
+	PROFILE_COUNT(COUNTER_SHADOW_RAYS);
+
+	// neighbouring pixels are usually blocked by the same object, so try last pixel's blocker first
+	int& lastOccluder = context.lastOccluder[lightIndex];
+	if (lastOccluder >= 0 && occludes(lastOccluder, shadowRayOrigin, lightDir, lightDistance)) {
+		PROFILE_COUNT(COUNTER_OCCLUDER_CACHE_HITS);
+		return true;
+	}
+	PROFILE_COUNT(COUNTER_OCCLUDER_CACHE_MISSES);
+
+	// only objects whose bounds the ray crosses are tested, the walk stops at the first blocker
+	int skip = lastOccluder;
+	int blocker = bvh.intersectAny(shadowRayOrigin, lightDir, lightDistance, [&](int index) {
+		return index != skip && occludes(index, shadowRayOrigin, lightDir, lightDistance);
+	});
+	if (blocker < 0) {
+		return false;
+	}
+	lastOccluder = blocker;
+	return true;
+}
+
+#ifdef RAYTRACER_PROFILE
+// the counter of ray tests against objects of one type
+static ProfileCounter testCounter(int type) {
+	switch (type) {
+	case SHAPE_CYLINDER: return COUNTER_CYLINDER_TESTS;
+	case SHAPE_CONE: return COUNTER_CONE_TESTS;
+	case SHAPE_SPHERE: return COUNTER_SPHERE_TESTS;
+	case SHAPE_SPECIAL1: return COUNTER_TORUS_TESTS;
+	case SHAPE_MESH: return COUNTER_MESH_TESTS;
+	default: return COUNTER_CUBE_TESTS;
+	}
+}
+#endif
+
+// t of the ray against one object (-1 on a miss), straight to the typed intersection
+// so the render threads skip the virtual draw() dispatch
+float RayTracer::intersect(int object, const glm::vec3& origin, const glm::vec3& dir) {
+	PROFILE_COUNT(testCounter(compiledScene.objectTypes[object]));
+	const glm::mat4& inverseMatrix = compiledScene.primitive(object).inverseTransformMatrix;
+	switch (compiledScene.objectTypes[object]) {
+	case SHAPE_CYLINDER:
+		return cylinder->intersect(origin, dir, inverseMatrix);
+	case SHAPE_CONE:
+		return cone->intersect(origin, dir, inverseMatrix);
+	case SHAPE_SPHERE:
+		return sphere->intersect(origin, dir, inverseMatrix);
+	case SHAPE_SPECIAL1:
+		return torus->intersect(origin, dir, inverseMatrix);
+	case SHAPE_MESH:
+		return compiledScene.meshModels[compiledScene.objectSlots[object]]->intersect(origin, dir, inverseMatrix, INTERSECTION_EPSILON);
+	case SHAPE_CUBE:
+	default:
+		return cube->intersect(origin, dir, inverseMatrix);
+	}
+}
+
+// true if the object blocks the ray somewhere in (SHADOW_EPSILON, maxDistance)
+bool RayTracer::occludes(int object, const glm::vec3& origin, const glm::vec3& dir, float maxDistance) {
+	if (compiledScene.objectTypes[object] == SHAPE_MESH) {
+		// any triangle in the way will do, no need to find the closest
+		PROFILE_COUNT(COUNTER_MESH_TESTS);
+		int slot = compiledScene.objectSlots[object];
+		return compiledScene.meshModels[slot]->occludes(origin, dir, compiledScene.meshes[slot].inverseTransformMatrix, SHADOW_EPSILON, maxDistance);
+	}
+	float t = intersect(object, origin, dir);
+	return t > SHADOW_EPSILON && t < maxDistance;
+}
+
+// world space box of an object, every primitive fits inside the unit cube centered at the origin
+// and meshes know their own, usually tighter, box
+AABB RayTracer::getWorldBounds(const SceneObject& object) {
+	glm::vec3 low(-0.5f), high(0.5f);
+	Mesh* mesh = findMesh(object.primitive);
+	if (mesh != NULL) {
+		low = mesh->getBounds().min;
+		high = mesh->getBounds().max;
+	}
+	AABB bounds;
+	for (int i = 0; i < 8; i++) {
+		glm::vec4 corner((i & 1) ? high.x : low.x, (i & 2) ? high.y : low.y, (i & 4) ? high.z : low.z, 1.0f);
+		bounds.expand(glm::vec3(object.transformMatrix * corner));
+	}
+	// pad so that hits found in object space never fall just outside the box from rounding
+	glm::vec3 pad = (bounds.max - bounds.min) * 1e-4f + glm::vec3(1e-5f);
+	bounds.min -= pad;
+	bounds.max += pad;
+	return bounds;
+}
+
+void RayTracer::buildBVH() {
+	objectBounds.resize(sceneObjects.size());
+	for (size_t i = 0; i < sceneObjects.size(); i++) {
+		objectBounds[i] = getWorldBounds(sceneObjects[i]);
+	}
+	bvh.build(objectBounds);
+}
+
+// the pool is recreated with the new size on the next render
+void RayTracer::setNumThreads(int threads) {
+	if (threads == numThreads) return;
+	numThreads = threads;
+	if (threadPool != NULL) {
+		delete threadPool;
+		threadPool = NULL;
+	}
+}
+
+RenderStats RayTracer::getRenderStats() {
+	RenderStats total = RenderStats();
+	for (size_t i = 0; i < threadContexts.size(); i++) {
+		const RenderStats& stats = threadContexts[i].stats;
+		total.primaryRays += stats.primaryRays;
+		total.shadowRays += stats.shadowRays;
+		total.reflectionRays += stats.reflectionRays;
+		total.traceSeconds += stats.traceSeconds;
+		total.shadeSeconds += stats.shadeSeconds;
+		total.refinedPixels += stats.refinedPixels;
+		total.culledLights += stats.culledLights;
+	}
+	total.updatedObjects = updatedObjects;
+	return total;
+}
+
+void RayTracer::setMaxSamples(int samples) {
+	// only whole grids, every level splits each cell of the one before in four
+	maxSamples = 1;
+	while (maxSamples * 4 <= std::min(samples, MAX_SAMPLES)) {
+		maxSamples *= 4;
+	}
+}
+
+void RayTracer::setLensSamples(int samples) {
+	lensSamples = std::max(1, std::min(samples, MAX_SAMPLES));
+}
+
+void RayTracer::setLightSamples(int samples) {
+	lightGrid = 1;
+	while (lightGrid * lightGrid * 4 <= std::min(samples, MAX_SAMPLES)) {
+		lightGrid *= 2;
+	}
+}
+
+void RayTracer::sampleHeatmap(unsigned char* heatmap) {
+	int count = pixelWidth * pixelHeight;
+	if ((int)sampleCounts.size() != count) {
+		memset(heatmap, 0, count * 3);
+		return;
+	}
+	// the levels are powers of four, so the log puts them evenly along the ramp
+	float top = log((float)std::max(maxSamples, 4));
+	for (int i = 0; i < count; i++) {
+		float level = std::min(log((float)sampleCounts[i]) / top, 1.0f);
+		heatmap[i * 3 + 0] = (unsigned char)(level * 255);
+		heatmap[i * 3 + 1] = (unsigned char)((1.0f - fabs(2.0f * level - 1.0f)) * 255);
+		heatmap[i * 3 + 2] = (unsigned char)((1.0f - level) * 255);
+	}
+}
+
+// decodes every texture used by the scene up front so the render threads never write to the store
+void RayTracer::loadTextures() {
+	for (auto& obj : sceneObjects) {
+		SceneFileMap* textureMap = obj.primitive->material.textureMap;
+		if (textureMap->isUsed) {
+			textureStore.load(textureMap->filename);
+		}
+	}
+}
+
+// reads every mesh file the scene uses that isn't cached yet, building its triangle BVH. Large
+// files are parsed on the render threads
+void RayTracer::loadMeshes() {
+	for (auto& obj : sceneObjects) {
+		const ScenePrimitive* primitive = obj.primitive;
+		if (primitive->type != SHAPE_MESH || meshCache.find(primitive->meshfile) != meshCache.end()) {
+			continue;
+		}
+		PROFILE_COUNT(COUNTER_MESH_CACHE_MISSES);
+		if (threadPool == NULL) {
+			threadPool = new ThreadPool(numThreads);
+		}
+		Mesh* mesh = new Mesh();
+		if (!mesh->load(primitive->meshfile, threadPool)) {
+			cout << "mesh " << primitive->meshfile << " has no triangles, drawing a cube instead" << endl;
+		}
+		meshCache[primitive->meshfile] = mesh;
+	}
+}
+
+// the loaded mesh of a mesh primitive, NULL for other types and meshes that failed to load
+Mesh* RayTracer::findMesh(const ScenePrimitive* primitive) {
+	if (primitive->type != SHAPE_MESH) return NULL;
+	auto found = meshCache.find(primitive->meshfile);
+	if (found == meshCache.end() || found->second->getTriangleCount() == 0) return NULL;
+	return found->second;
+}
+
+// textures have to be loaded already
+MaterialRecord RayTracer::compileMaterial(const SceneMaterial& source) {
+	MaterialRecord material;
+	material.ambient = glm::vec3(source.cAmbient.r, source.cAmbient.g, source.cAmbient.b);
+	material.diffuse = glm::vec3(source.cDiffuse.r, source.cDiffuse.g, source.cDiffuse.b);
+	material.specular = glm::vec3(source.cSpecular.r, source.cSpecular.g, source.cSpecular.b);
+	material.reflective = glm::vec3(source.cReflective.r, source.cReflective.g, source.cReflective.b);
+	material.shininess = source.shininess;
+	material.blend = source.blend;
+	material.texture = -1;
+	material.repeatU = (int)source.textureMap->repeatU;
+	material.repeatV = (int)source.textureMap->repeatV;
+	if (source.textureMap->isUsed) {
+		material.texture = textureStore.find(source.textureMap->filename);
+	}
+	return material;
+}
+
+// copies what the render threads need out of sceneObjects and the parser into flat arrays
+void RayTracer::compileScene() {
+	compiledScene.clear();
+	// objects instanced through the same master node share one primitive and so one material
+	materialIndices.clear();
+
+	for (const auto& obj : sceneObjects) {
+		const ScenePrimitive* primitive = obj.primitive;
+		auto found = materialIndices.find(primitive);
+		int materialIndex;
+		if (found != materialIndices.end()) {
+			materialIndex = found->second;
+		}
+		else {
+			materialIndex = (int)compiledScene.materials.size();
+			compiledScene.materials.push_back(compileMaterial(primitive->material));
+			materialIndices[primitive] = materialIndex;
+		}
+
+		// the type of the shape that intersects it, unsupported types fall back to the cube
+		Mesh* mesh = findMesh(primitive);
+		OBJ_TYPE type = mesh != NULL ? SHAPE_MESH : getShape(primitive->type)->getType();
+		std::vector<PrimitiveRecord>& primitives = compiledScene.primitives(type);
+		PrimitiveRecord record = { obj.inverseTransformMatrix, obj.normalMatrix, materialIndex };
+		compiledScene.objectTypes.push_back(type);
+		compiledScene.objectSlots.push_back((int)primitives.size());
+		primitives.push_back(record);
+		if (mesh != NULL) {
+			compiledScene.meshModels.push_back(mesh);
+		}
+	}
+
+	// lights are read for every hit, so copy them out of the parser once per frame
+	for (int i = 0; i < parser->getNumLights(); i++) {
+		SceneLightData lightData;
+		parser->getLightData(i, lightData);
+		LightRecord light;
+		light.color = glm::vec3(lightData.color.r, lightData.color.g, lightData.color.b);
+		light.type = lightData.type;
+		light.position = lightData.pos;
+		light.function = lightData.function;
+		light.axisU = light.axisV = glm::vec3(0.0f);
+		light.cosOuter = light.cosInner = -1.0f;
+		if (lightData.type == LIGHT_SPOT || lightData.type == LIGHT_AREA) {
+			// spots and area lights without a direction shine straight down
+			glm::vec3 normal = glm::dot(lightData.dir, lightData.dir) > 0.0f ? glm::normalize(lightData.dir) : glm::vec3(0, -1, 0);
+			glm::vec3 helper = fabs(normal.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+			glm::vec3 u = glm::normalize(glm::cross(helper, normal));
+			glm::vec3 v = glm::cross(normal, u);
+			light.direction = -normal;
+			if (lightData.type == LIGHT_AREA) {
+				light.axisU = u * (0.5f * lightData.width);
+				light.axisV = v * (0.5f * lightData.height);
+			}
+			else {
+				light.axisU = u * lightData.radius;
+				light.axisV = v * lightData.radius;
+				// angle is the half angle of the cone in degrees, the light fades out over the outer penumbra degrees of it
+				if (lightData.angle > 0.0f) {
+					float outer = glm::radians(std::min(lightData.angle, 180.0f));
+					float inner = std::max(outer - glm::radians(std::max(lightData.penumbra, 0.0f)), 0.0f);
+					light.cosOuter = cos(outer);
+					light.cosInner = cos(inner);
+				}
+			}
+		}
+		else {
+			light.direction = glm::normalize(-lightData.dir);
+		}
+		light.hasExtent = glm::dot(light.axisU, light.axisU) > 0.0f || glm::dot(light.axisV, light.axisV) > 0.0f;
+		compiledScene.lights.push_back(light);
+	}
+}
+
+// traces every pixel of one TILE_SIZE x TILE_SIZE block of the framebuffer
+void RayTracer::renderTile(int tileIndex, const glm::vec3& eyePoint, ThreadContext& context) {
+	int tilesX = (pixelWidth + TILE_SIZE - 1) / TILE_SIZE;
+	int startX = (tileIndex % tilesX) * TILE_SIZE;
+	int startY = (tileIndex / tilesX) * TILE_SIZE;
+	int endX = std::min(startX + TILE_SIZE, pixelWidth);
+	int endY = std::min(startY + TILE_SIZE, pixelHeight);
+	if (cancelFlag != NULL && *cancelFlag) return;
+
+	// the pixels this pass traces, row by row, as offsets into the tile
+	int tileWidth = endX - startX;
+	int offsets[TILE_SIZE * TILE_SIZE];
+	int count = 0;
+	for (int j = startY; j < endY; j += passStep) {
+		// on rows of the previous pass's grid every other pixel is already traced
+		bool skipDone = refinePass && j % (2 * passStep) == 0;
+		int first = startX + (skipDone ? passStep : 0);
+		int stride = skipDone ? 2 * passStep : passStep;
+		for (int i = first; i < endX; i += stride) {
+			offsets[count++] = (j - startY) * tileWidth + (i - startX);
+		}
+	}
+
+	if (rayGenerator.thinLens) {
+		PROFILE_SCOPE("lens");
+		for (int p = 0; p < count; p++) {
+			int x = startX + offsets[p] % tileWidth;
+			int y = startY + offsets[p] / tileWidth;
+			int object;
+			glm::vec3 color = lensPixel(x, y, object, context);
+			fillBlock(x, y, endX, endY, color.r * 255, color.g * 255, color.b * 255, object);
+		}
+		return;
+	}
+
+	// directions for the whole tile at once, coarse passes only use some of them
+	glm::vec3 tileRays[TILE_SIZE * TILE_SIZE];
+	rayGenerator.generateTile(startX, startY, tileWidth, endY - startY, tileRays);
+
+	// all primary hits first: neighbouring pixels go down the BVH together as packets,
+	// the last packet may run past count
+	float t[TILE_SIZE * TILE_SIZE + PACKET_SIZE];
+	int hitIndex[TILE_SIZE * TILE_SIZE + PACKET_SIZE];
+	auto traceStart = std::chrono::steady_clock::now();
+	{
+		PROFILE_SCOPE("trace");
+		RayPacket<PACKET_SIZE> rays;
+		for (int p = 0; p < count; p += PACKET_SIZE) {
+			int lanes = std::min(PACKET_SIZE, count - p);
+			for (int lane = 0; lane < PACKET_SIZE; lane++) {
+				// lanes past the end repeat the last pixel and are ignored
+				rays.set(lane, eyePoint, tileRays[offsets[p + std::min(lane, lanes - 1)]]);
+			}
+			findClosestObjects(rays, t + p, hitIndex + p);
+		}
+	}
+	auto shadeStart = std::chrono::steady_clock::now();
+	context.stats.primaryRays += count;
+	PROFILE_COUNT_N(COUNTER_PRIMARY_RAYS, count);
+
+	{
+		PROFILE_SCOPE("shade");
+		for (int p = 0; p < count; p++) {
+			int x = startX + offsets[p] % tileWidth;
+			int y = startY + offsets[p] / tileWidth;
+			int r = 0, g = 0, b = 0;
+			int object = (hitIndex[p] >= 0 && t[p] > 0) ? hitIndex[p] : -1;
+			if (object >= 0) {
+				if (isectOnly) {
+					r = g = b = 255;
+				} else {
+					const glm::vec3& ray = tileRays[offsets[p]];
+					IntersectionInfo isect = makeIntersection(eyePoint, ray, object, t[p]);
+					glm::vec3 color = shadeIntersection(eyePoint, ray, isect, recurseDepth, context);
+					r = color.r * 255;
+					g = color.g * 255;
+					b = color.b * 255;
+				}
+			}
+			fillBlock(x, y, endX, endY, r, g, b, object);
+		}
+	}
+	auto shadeEnd = std::chrono::steady_clock::now();
+	context.stats.traceSeconds += std::chrono::duration<double>(shadeStart - traceStart).count();
+	context.stats.shadeSeconds += std::chrono::duration<double>(shadeEnd - shadeStart).count();
+}
+
+// coarse passes stretch the pixel over its whole block, finer passes overwrite it
+void RayTracer::fillBlock(int x, int y, int endX, int endY, int r, int g, int b, int object) {
+	for (int fillY = y; fillY < std::min(y + passStep, endY); fillY++) {
+		for (int fillX = x; fillX < std::min(x + passStep, endX); fillX++) {
+			setpixel(pixels, fillX, fillY, r, g, b);
+			pixelObjects[fillY * pixelWidth + fillX] = object;
+		}
+	}
+}
+
+// flattens the scene graph and builds the BVH, textures and compiled scene the render passes read
+void RayTracer::prepareScene() {
+	if (parser == NULL) {
+		sceneObjects.clear();
+		return;
+	}
+	if (!sceneDirty && updateScene()) {
+		return;
+	}
+	sceneObjects.clear();
+	flattenedNodes.clear();
+	nodeVisits.clear();
+	SceneNode* root = parser->getRootNode();
+	glm::mat4 compositeMatrix(1.0f);
+	
+	// traverse scene graph from root note to build out vector of objects in scene graph
+	{
+		PROFILE_SCOPE("flatten");
+		traverseSceneGraph(root, compositeMatrix);
+	}
+
+	std::cout << "number of objects: " << sceneObjects.size() << std::endl;
+	// before the BVH, which needs the mesh bounds
+	{
+		PROFILE_SCOPE("load meshes");
+		loadMeshes();
+	}
+	{
+		PROFILE_SCOPE("build BVH");
+		buildBVH();
+	}
+	{
+		PROFILE_SCOPE("load textures");
+		loadTextures();
+	}
+	{
+		PROFILE_SCOPE("compile scene");
+		compileScene();
+	}
+	sceneDirty = false;
+	updatedObjects = 0;
+	clearChanges();
+}
+
+void RayTracer::render(Camera* camera, unsigned char* pixels, int width, int height, int recurseDepth, bool isectOnly) {
+	if (parser == NULL) {
+		cout << "no scene loaded yet" << endl;
+		return;
+	}
+	prepareScene();
+	renderPass(camera, pixels, width, height, recurseDepth, isectOnly, 1, false, NULL);
+	antialiasPass(NULL);
+	cout << "render complete (" << threadPool->size() << " threads)" << endl;
+}
+
+bool RayTracer::renderPass(Camera* camera, unsigned char* pixels, int width, int height, int recurseDepth, bool isectOnly, int step, bool refine, const std::atomic<bool>* cancel) {
+	if (parser == NULL) {
+		return false;
+	}
+	PROFILE_SCOPE("render pass");
+	this->camera = camera;
+	this->pixels = pixels;
+	this->pixelWidth = width;
+	this->pixelHeight = height;
+	this->recurseDepth = recurseDepth;
+	this->isectOnly = isectOnly;
+	this->passStep = step;
+	this->refinePass = refine;
+	this->cancelFlag = cancel;
+
+	camera->setScreenSize(width, height);
+	// refining passes keep the focus of the pass they refine; a miss keeps the last distance
+	if (autoFocus && !refine && camera->getAperture() > 0.0f) {
+		glm::vec3 look = glm::normalize(camera->getLookVector());
+		float t;
+		if (findClosestObject(camera->getEyePoint(), look, t) >= 0) {
+			camera->setFocalDistance(t);
+		}
+	}
+	rayGenerator = camera->getRayGenerator();
+	pixelSpread = glm::length(rayGenerator.stepY);
+	const glm::vec3 eyePoint = rayGenerator.eyePoint;
+	if (!refine) {
+		memset(pixels, 0, width * height * 3);
+		pixelObjects.assign(width * height, -1);
+		sampleCounts.assign(width * height, 1);
+	}
+
+	if (threadPool == NULL) {
+		threadPool = new ThreadPool(numThreads);
+	}
+	// occluders cached by the last frame may not even exist any more
+	threadContexts.assign(threadPool->size(), ThreadContext());
+	for (size_t i = 0; i < threadContexts.size(); i++) {
+		threadContexts[i].lastOccluder.assign(compiledScene.lights.size(), -1);
+		threadContexts[i].stats = RenderStats();
+	}
+
+	int tilesX = (pixelWidth + TILE_SIZE - 1) / TILE_SIZE;
+	int tilesY = (pixelHeight + TILE_SIZE - 1) / TILE_SIZE;
+	// every tile writes a disjoint part of pixels, so the threads need no locking
+	threadPool->run(tilesX * tilesY, [&](int tileIndex, int workerIndex) {
+		renderTile(tileIndex, eyePoint, threadContexts[workerIndex]);
+	});
+	return cancel == NULL || !*cancel;
+}
+
+bool RayTracer::antialiasPass(const std::atomic<bool>* cancel) {
+	// lens samples already cover the whole pixel
+	if (parser == NULL || pixels == NULL || maxSamples <= 1 || rayGenerator.thinLens) {
+		return cancel == NULL || !*cancel;
+	}
+	PROFILE_SCOPE("antialias pass");
+	this->cancelFlag = cancel;
+	// edges are found on the image as the last pass left it, refined pixels don't feed back
+	basePixels.assign(pixels, pixels + pixelWidth * pixelHeight * 3);
+	const glm::vec3 eyePoint = rayGenerator.eyePoint;
+
+	int tilesX = (pixelWidth + TILE_SIZE - 1) / TILE_SIZE;
+	int tilesY = (pixelHeight + TILE_SIZE - 1) / TILE_SIZE;
+	threadPool->run(tilesX * tilesY, [&](int tileIndex, int workerIndex) {
+		antialiasTile(tileIndex, eyePoint, threadContexts[workerIndex]);
+	});
+	return cancel == NULL || !*cancel;
+}
+
+void RayTracer::antialiasTile(int tileIndex, const glm::vec3& eyePoint, ThreadContext& context) {
+	int tilesX = (pixelWidth + TILE_SIZE - 1) / TILE_SIZE;
+	int startX = (tileIndex % tilesX) * TILE_SIZE;
+	int startY = (tileIndex / tilesX) * TILE_SIZE;
+	int endX = std::min(startX + TILE_SIZE, pixelWidth);
+	int endY = std::min(startY + TILE_SIZE, pixelHeight);
+	PROFILE_SCOPE("antialias");
+
+	for (int j = startY; j < endY; j++) {
+		if (cancelFlag != NULL && *cancelFlag) return;
+		for (int i = startX; i < endX; i++) {
+			if (!isEdgePixel(i, j)) continue;
+			int sampleCount;
+			glm::vec3 color = supersamplePixel(i, j, eyePoint, sampleCount, context);
+			sampleCounts[j * pixelWidth + i] = sampleCount;
+			context.stats.refinedPixels++;
+			setpixel(pixels, i, j, color.r * 255, color.g * 255, color.b * 255);
+		}
+	}
+}
+
+// an object boundary or a jump in color towards one of the four neighbours
+bool RayTracer::isEdgePixel(int x, int y) {
+	static const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	const int threshold = (int)(CONTRAST_THRESHOLD * 255);
+	int index = y * pixelWidth + x;
+	for (int n = 0; n < 4; n++) {
+		int nx = x + offsets[n][0];
+		int ny = y + offsets[n][1];
+		if (nx < 0 || ny < 0 || nx >= pixelWidth || ny >= pixelHeight) continue;
+		int other = ny * pixelWidth + nx;
+		if (pixelObjects[other] != pixelObjects[index]) return true;
+		for (int c = 0; c < 3; c++) {
+			if (abs(basePixels[index * 3 + c] - basePixels[other * 3 + c]) > threshold) return true;
+		}
+	}
+	return false;
+}
+
+// jitter in [0, 1) from a hash of the pixel and sample, so the image doesn't depend on the
+// thread count. 16 bits keep cell + jitter exact in a float, the cell of a sample never rounds up
+static float sampleJitter(int x, int y, int sample, int axis) {
+	unsigned int h = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ (unsigned int)(sample * 2 + axis) * 83492791u;
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return (h >> 16) * (1.0f / 65536.0f);
+}
+
+/* Grows a stratified pattern around the center sample the pass already traced: each
+   level splits every cell of the grid before it in four, one of the four already holds
+   a sample and the other three get a jittered one. After the level with n x n cells
+   there is exactly one sample per cell. Stops when the samples agree or the budget is
+   spent and returns their average. */
+glm::vec3 RayTracer::supersamplePixel(int x, int y, const glm::vec3& eyePoint, int& sampleCount, ThreadContext& context) {
+	// offsets run over [0, 1) across the pixel
+	float sampleX[MAX_SAMPLES], sampleY[MAX_SAMPLES];
+	glm::vec3 colors[MAX_SAMPLES];
+	const unsigned char* base = &basePixels[(y * pixelWidth + x) * 3];
+	sampleX[0] = sampleY[0] = 0.5f;
+	// the middle of the byte the color was truncated to
+	colors[0] = (glm::vec3(base[0], base[1], base[2]) + 0.5f) / 255.0f;
+	sampleCount = 1;
+	glm::vec3 sum = colors[0];
+
+	for (int cells = 2; cells * cells <= maxSamples; cells *= 2) {
+		bool taken[MAX_SAMPLES] = {};
+		for (int s = 0; s < sampleCount; s++) {
+			int cx = std::min((int)(sampleX[s] * cells), cells - 1);
+			int cy = std::min((int)(sampleY[s] * cells), cells - 1);
+			taken[cy * cells + cx] = true;
+		}
+		for (int cell = 0; cell < cells * cells && sampleCount < MAX_SAMPLES; cell++) {
+			if (taken[cell]) continue;
+			sampleX[sampleCount] = (cell % cells + sampleJitter(x, y, sampleCount, 0)) / cells;
+			sampleY[sampleCount] = (cell / cells + sampleJitter(x, y, sampleCount, 1)) / cells;
+			// pixel (x, y) covers [x - 0.5, x + 0.5) on the image plane
+			colors[sampleCount] = traceSample(eyePoint, x - 0.5f + sampleX[sampleCount], y - 0.5f + sampleY[sampleCount], context);
+			sum += colors[sampleCount];
+			sampleCount++;
+		}
+
+		glm::vec3 low = colors[0], high = colors[0];
+		for (int s = 1; s < sampleCount; s++) {
+			low = glm::min(low, colors[s]);
+			high = glm::max(high, colors[s]);
+		}
+		glm::vec3 range = high - low;
+		if (std::max(range.r, std::max(range.g, range.b)) <= CONTRAST_THRESHOLD) break;
+	}
+	return glm::clamp(sum / (float)sampleCount, 0.0f, 1.0f);
+}
+
+// k-th point of the van der Corput sequence in base, the digits of k mirrored behind the point
+static float radicalInverse(int k, int base) {
+	float inverseBase = 1.0f / base;
+	float scale = inverseBase;
+	float result = 0.0f;
+	for (; k > 0; k /= base) {
+		result += (k % base) * scale;
+		scale *= inverseBase;
+	}
+	return result;
+}
+
+// Shirley and Chiu's concentric map of the unit square onto the unit disk, it keeps strata apart
+static glm::vec2 concentricDisk(float a, float b) {
+	float sx = 2.0f * a - 1.0f;
+	float sy = 2.0f * b - 1.0f;
+	if (sx == 0.0f && sy == 0.0f) return glm::vec2(0.0f);
+	float radius, angle;
+	if (fabs(sx) > fabs(sy)) {
+		radius = sx;
+		angle = (PI / 4.0f) * (sy / sx);
+	}
+	else {
+		radius = sy;
+		angle = PI / 2.0f - (PI / 4.0f) * (sx / sy);
+	}
+	return glm::vec2(radius * cos(angle), radius * sin(angle));
+}
+
+/* Mean of lensSamples thin lens rays through pixel (x, y). Sample k uses point k of
+   the Halton sequence: bases 2 and 3 pick the point on the lens, 5 and 7 where in the
+   pixel it aims. Every pixel shifts the sequence by its own random offset (a
+   Cranley-Patterson rotation) so neighbours don't repeat one pattern. object is what
+   the first sample hit, for the edge detection of later passes. */
+glm::vec3 RayTracer::lensPixel(int x, int y, int& object, ThreadContext& context) {
+	static const int BASES[4] = { 2, 3, 5, 7 };
+	float shift[4];
+	for (int d = 0; d < 4; d++) {
+		shift[d] = sampleJitter(x, y, MAX_SAMPLES, d);
+	}
+
+	glm::vec3 sum(0.0f);
+	object = -1;
+	glm::vec3 origins[PACKET_SIZE], dirs[PACKET_SIZE];
+	float t[PACKET_SIZE];
+	int hitIndex[PACKET_SIZE];
+	RayPacket<PACKET_SIZE> rays;
+	double traceSeconds = 0.0, shadeSeconds = 0.0;
+	for (int first = 0; first < lensSamples; first += PACKET_SIZE) {
+		int lanes = std::min(PACKET_SIZE, lensSamples - first);
+		for (int lane = 0; lane < lanes; lane++) {
+			float u[4];
+			for (int d = 0; d < 4; d++) {
+				u[d] = radicalInverse(first + lane, BASES[d]) + shift[d];
+				if (u[d] >= 1.0f) u[d] -= 1.0f;
+			}
+			glm::vec2 lens = concentricDisk(u[0], u[1]);
+			rayGenerator.generateLensSample(x - 0.5f + u[2], y - 0.5f + u[3], lens.x, lens.y, origins[lane], dirs[lane]);
+		}
+
+		auto traceStart = std::chrono::steady_clock::now();
+		if (lensPackets) {
+			for (int lane = 0; lane < PACKET_SIZE; lane++) {
+				// lanes past the last sample repeat it and are ignored
+				int sample = std::min(lane, lanes - 1);
+				rays.set(lane, origins[sample], dirs[sample]);
+			}
+			findClosestObjects(rays, t, hitIndex);
+		}
+		else {
+			for (int lane = 0; lane < lanes; lane++) {
+				hitIndex[lane] = findClosestObject(origins[lane], dirs[lane], t[lane]);
+			}
+		}
+		auto shadeStart = std::chrono::steady_clock::now();
+
+		for (int lane = 0; lane < lanes; lane++) {
+			int hit = (hitIndex[lane] >= 0 && t[lane] > 0) ? hitIndex[lane] : -1;
+			if (first + lane == 0) object = hit;
+			if (hit < 0) continue;
+			if (isectOnly) {
+				sum += glm::vec3(1.0f);
+				continue;
+			}
+			IntersectionInfo isect = makeIntersection(origins[lane], dirs[lane], hit, t[lane]);
+			sum += shadeIntersection(origins[lane], dirs[lane], isect, recurseDepth, context);
+		}
+		auto shadeEnd = std::chrono::steady_clock::now();
+		traceSeconds += std::chrono::duration<double>(shadeStart - traceStart).count();
+		shadeSeconds += std::chrono::duration<double>(shadeEnd - shadeStart).count();
+	}
+	context.stats.primaryRays += lensSamples;
+	PROFILE_COUNT_N(COUNTER_PRIMARY_RAYS, lensSamples);
+	context.stats.traceSeconds += traceSeconds;
+	context.stats.shadeSeconds += shadeSeconds;
+	return sum / (float)lensSamples;
+}
+
+// color of one primary ray through the image plane point (x, y)
+glm::vec3 RayTracer::traceSample(const glm::vec3& eyePoint, float x, float y, ThreadContext& context) {
+	glm::vec3 ray = rayGenerator.generateSample(x, y);
+	auto traceStart = std::chrono::steady_clock::now();
+	IntersectionInfo isect = findClosestIntersection(eyePoint, ray);
+	auto shadeStart = std::chrono::steady_clock::now();
+	context.stats.primaryRays++;
+	PROFILE_COUNT(COUNTER_PRIMARY_RAYS);
+
+	glm::vec3 color(0.0f);
+	if (isect.object >= 0 && isect.t > 0) {
+		color = isectOnly ? glm::vec3(1.0f) : shadeIntersection(eyePoint, ray, isect, recurseDepth, context);
+	}
+	auto shadeEnd = std::chrono::steady_clock::now();
+	context.stats.traceSeconds += std::chrono::duration<double>(shadeStart - traceStart).count();
+	context.stats.shadeSeconds += std::chrono::duration<double>(shadeEnd - shadeStart).count();
+	return color;
+}
+
+// returns the index of the nearest object hit by the ray and its t value, or -1 (t = -1) on a miss
+int RayTracer::findClosestObject(const glm::vec3& origin, const glm::vec3& ray, float& t) {
+	int hitIndex = bvh.intersectClosest(origin, ray, INTERSECTION_EPSILON, t, [&](int index) {
+		return intersect(index, origin, ray);
+	});
+	if (hitIndex < 0) {
+		t = -1;
+	}
+	return hitIndex;
+}
+
+// packet version of findClosestObject, t and hitIndex get one entry per lane (-1 on a miss)
+void RayTracer::findClosestObjects(const RayPacket<PACKET_SIZE>& rays, float* t, int* hitIndex) {
+	bvh.intersectClosestPacket(rays, INTERSECTION_EPSILON, t, hitIndex, [&](int index, float* tOut) {
+		intersectPacket(index, rays, tOut);
+	});
+	for (int i = 0; i < PACKET_SIZE; i++) {
+		if (hitIndex[i] < 0) t[i] = -1;
+	}
+}
+
+// runs the packet kernel of the object's shape, one t (or -1) per lane
+void RayTracer::intersectPacket(int object, const RayPacket<PACKET_SIZE>& rays, float* t) {
+	PROFILE_COUNT_N(testCounter(compiledScene.objectTypes[object]), PACKET_SIZE);
+	const glm::mat4& inverseMatrix = compiledScene.primitive(object).inverseTransformMatrix;
+	switch (compiledScene.objectTypes[object]) {
+	case SHAPE_CYLINDER:
+		cylinder->intersectPacket(rays, inverseMatrix, t);
+		break;
+	case SHAPE_CONE:
+		cone->intersectPacket(rays, inverseMatrix, t);
+		break;
+	case SHAPE_SPHERE:
+		sphere->intersectPacket(rays, inverseMatrix, t);
+		break;
+	case SHAPE_SPECIAL1:
+		torus->intersectPacket(rays, inverseMatrix, t);
+		break;
+	case SHAPE_MESH: {
+		// each lane walks the mesh BVH on its own, the packet already paid off in the scene BVH
+		const Mesh* mesh = compiledScene.meshModels[compiledScene.objectSlots[object]];
+		for (int i = 0; i < PACKET_SIZE; i++) {
+			t[i] = mesh->intersect(rays.origin(i), rays.dir(i), inverseMatrix, INTERSECTION_EPSILON);
+		}
+		break;
+	}
+	case SHAPE_CUBE:
+	default:
+		cube->intersectPacket(rays, inverseMatrix, t);
+		break;
+	}
+}
+
+// New helper function to find closest intersection
+IntersectionInfo RayTracer::findClosestIntersection(const glm::vec3& origin, const glm::vec3& ray) {
+	float t = -1;
+	int hitIndex = findClosestObject(origin, ray, t);
+	return makeIntersection(origin, ray, hitIndex, t);
+}
+
+// fills in the hit point and normal for object hitIndex hit at t, hitIndex -1 means a miss
+IntersectionInfo RayTracer::makeIntersection(const glm::vec3& origin, const glm::vec3& ray, int hitIndex, float t) {
+	IntersectionInfo result;
+	result.t = t;
+	result.object = hitIndex;
+
+	result.shape = nullptr;
+	if (result.object >= 0) {
+		const PrimitiveRecord& primitive = compiledScene.primitive(hitIndex);
+		result.point = origin + result.t * ray;
+		// the shape travels with the result instead of a member so threads don't share it
+		if (compiledScene.objectTypes[hitIndex] == SHAPE_MESH) {
+			Mesh* mesh = compiledScene.meshModels[compiledScene.objectSlots[hitIndex]];
+			result.shape = mesh;
+			result.normal = mesh->hitNormal(origin, ray, primitive.inverseTransformMatrix, primitive.normalMatrix, INTERSECTION_EPSILON);
+		}
+		else {
+			result.shape = getShape(compiledScene.objectTypes[hitIndex]);
+			result.normal = result.shape->drawNormal(origin, result.point, primitive.inverseTransformMatrix, primitive.normalMatrix, result.t);
+		}
+	}
+
+	return result;
+}
+
+/* Color seen along ray at a known hit, following its mirror bounces up to maxDepth in a
+   loop. Every bounce is clamped before the one in front of it sees it, so the loop
+   keeps each bounce's direct light and reflectance and adds them up back to front
+   once the path ends. A path ends early when its throughput, the product of the
+   kr * reflective weights so far, can no longer change the pixel, or when Russian
+   roulette stops it. Textures are filtered over the pixel's ray cone, which widens
+   with the distance travelled along the whole path. */
+glm::vec3 RayTracer::shadeIntersection(const glm::vec3& origin, const glm::vec3& ray, const IntersectionInfo& firstHit, int maxDepth, ThreadContext& context) {
+    std::vector<glm::vec3>& direct = context.bounceDirect;
+    std::vector<glm::vec3>& reflective = context.bounceReflective;
+    direct.clear();
+    reflective.clear();
+    float kr = globalSceneData.ks;
+
+    glm::vec3 rayOrigin = origin;
+    glm::vec3 rayDir = ray;
+    IntersectionInfo isect = firstHit;
+    glm::vec3 throughput(1.0f);
+    float distance = 0.0f;
+    for (int depth = 0; ; depth++) {
+        const MaterialRecord& material = compiledScene.materials[compiledScene.primitive(isect.object).material];
+        distance += glm::length(isect.point - rayOrigin);
+        direct.push_back(surfaceColor(rayOrigin, isect, distance * pixelSpread, context));
+        if (kr <= 0.0f || depth >= maxDepth) {
+            break;
+        }
+
+        glm::vec3 weight = material.reflective;
+        throughput *= kr * weight;
+        float strength = std::max(throughput.r, std::max(throughput.g, throughput.b));
+        if (strength < REFLECTION_CUTOFF) {
+            break;
+        }
+        if (russianRoulette && strength < ROULETTE_START) {
+            // survivors carry the weight of the paths that were stopped
+            float survival = strength / ROULETTE_START;
+            if (rouletteSample(rayDir, depth) >= survival) {
+                break;
+            }
+            weight /= survival;
+            throughput /= survival;
+        }
+        reflective.push_back(weight);
+
+        glm::vec3 v = glm::normalize(rayDir);
+        rayDir = v - 2 * glm::dot(v, isect.normal) * isect.normal;
+        rayOrigin = isect.point + SHADOW_EPSILON * isect.normal;
+        context.stats.reflectionRays++;
+        PROFILE_COUNT(COUNTER_REFLECTION_RAYS);
+        isect = findClosestIntersection(rayOrigin, rayDir);
+        if (isect.object < 0) {
+            break;
+        }
+    }
+
+    // a reflection that left the scene sees black
+    glm::vec3 color(0.0f);
+    for (int k = (int)direct.size() - 1; k >= 0; k--) {
+        glm::vec3 bounce = direct[k];
+        if (k < (int)reflective.size()) {
+            glm::vec3 reflectedColor = glm::vec3(
+                color.r * reflective[k].r,
+                color.g * reflective[k].g,
+                color.b * reflective[k].b
+            );
+            bounce += kr * reflectedColor;
+        }
+        color = glm::clamp(bounce, 0.0f, 1.0f);
+    }
+    return color;
+}
+
+// uniform in [0, 1) from the bits of the ray, the same path always makes the same choice
+float RayTracer::rouletteSample(const glm::vec3& dir, int depth) {
+    unsigned int bits[3];
+    memcpy(bits, &dir, sizeof(bits));
+    unsigned int h = bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u ^ (unsigned int)depth * 2654435761u;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return (h >> 8) * (1.0f / 16777216.0f);
+}
+
+/* Extent in uv of a footprint wide patch of surface around the hit, measured by
+   stepping across the tangent plane, stretched along the ray by 1 / cos. Each step
+   is taken both ways and the smaller change in uv kept, so a step over a uv seam or
+   a cube edge doesn't blow the footprint up. */
+glm::vec2 RayTracer::uvFootprint(const IntersectionInfo& isect, const glm::vec3& dir, float footprint, const glm::mat4& inverseMatrix, glm::vec2 uv) {
+    glm::vec3 d = glm::normalize(dir);
+    const glm::vec3& n = isect.normal;
+    // grazing hits stretch the footprint by at most 8x
+    float cosine = std::max(fabs(glm::dot(d, n)), 0.125f);
+    glm::vec3 along = d - glm::dot(d, n) * n;
+    if (glm::dot(along, along) < 1e-12f) {
+        along = fabs(n.x) < 0.9f ? glm::cross(n, glm::vec3(1.0f, 0.0f, 0.0f)) : glm::cross(n, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+    along = glm::normalize(along);
+    glm::vec3 steps[2] = { along * (footprint / cosine), glm::normalize(glm::cross(n, along)) * footprint };
+
+    glm::vec2 extent(0.0f);
+    for (int i = 0; i < 2; i++) {
+        glm::vec3 forward = glm::vec3(inverseMatrix * glm::vec4(isect.point + steps[i], 1.0f));
+        glm::vec3 backward = glm::vec3(inverseMatrix * glm::vec4(isect.point - steps[i], 1.0f));
+        glm::vec2 a = glm::abs(isect.shape->getUVCoordinates(forward) - uv);
+        glm::vec2 b = glm::abs(isect.shape->getUVCoordinates(backward) - uv);
+        extent = glm::max(extent, glm::min(a, b));
+    }
+    return extent;
+}
+
+// texture and direct light at a hit, seen from origin through a ray cone footprint wide there
+glm::vec3 RayTracer::surfaceColor(const glm::vec3& origin, const IntersectionInfo& isect, float footprint, ThreadContext& context) {
+    const PrimitiveRecord& primitive = compiledScene.primitive(isect.object);
+    const MaterialRecord& material = compiledScene.materials[primitive.material];
+
+    // texture mapping, resolved to a TextureStore handle by compileScene()
+    glm::vec3 textureMap(0.0f);
+    if (material.texture >= 0) {
+        PROFILE_COUNT(COUNTER_TEXTURE_LOOKUPS);
+        // uv comes from the object space point
+        const glm::mat4& inverseMatrix = primitive.inverseTransformMatrix;
+        glm::vec3 objPoint = glm::vec3(inverseMatrix * glm::vec4(isect.point, 1.0f));
+        glm::vec2 uv = isect.shape->getUVCoordinates(objPoint);
+        glm::vec2 repeat((float)material.repeatU, (float)material.repeatV);
+        glm::vec2 extent = uvFootprint(isect, isect.point - origin, footprint, inverseMatrix, uv);
+        textureMap = textureStore.sample(material.texture, uv * repeat, extent * repeat);
+    }
+
+    return calculateObjectLighting(material, isect.normal, isect.point, textureMap, origin, context);
+}
\ No newline at end of file
@@ -0,0 +1,240 @@
+#ifndef RAYTRACER_H
+#define RAYTRACER_H
+
+#include <glm/glm.hpp>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <atomic>
+
+#include "Shape.h"
+#include "Cube.h"
+#include "Cylinder.h"
+#include "Cone.h"
+#include "Sphere.h"
+#include "Torus.h"
+#include "Mesh.h"
+#include "TextureStore.h"
+#include "BVH.h"
+#include "ThreadPool.h"
+#include "CompiledScene.h"
+#include "Profiler.h"
+
+#include "Camera.h"
+#include "scene/SceneParser.h"
+
+
+struct SceneObject {
+	glm::mat4 transformMatrix;
+	glm::mat4 inverseTransformMatrix;   // world to object, computed once in traverseSceneGraph
+	glm::mat3 normalMatrix;             // transpose of the inverse's upper 3x3, for normals
+	ScenePrimitive* primitive;  // Use smart pointer
+};
+// one visit of a scene graph node while flattening, nodes used as masters get one per instance
+struct FlattenedNode {
+	SceneNode* node;
+	glm::mat4 parentTransform;
+	int firstObject;        // the node's own primitives start here in sceneObjects, its children's follow
+	int visitEnd;           // visits of the subtree run from this one up to here
+	int primitiveCount, childCount;     // as flattened, an edit that changes them needs a full flatten
+};
+struct IntersectionInfo {
+	float t;
+	int object;         // index of the object hit, -1 on a miss
+	Shape* shape;       // shape used to intersect object, owned by the ray tracer
+	glm::vec3 point;
+	glm::vec3 normal;
+};
+// ray counts and time spent in the last render pass, see RayTracer::getRenderStats()
+struct RenderStats {
+	long long primaryRays;
+	long long shadowRays;
+	long long reflectionRays;
+	double traceSeconds;    // finding the primary hits, summed over the threads
+	double shadeSeconds;    // shading them, including their shadow and reflection rays
+	long long refinedPixels;    // pixels the antialiasing pass took more samples in
+	long long culledLights;     // lights skipped at a hit for being too dim there
+	long long updatedObjects;   // objects the last incremental scene update moved, 0 after a full flatten
+};
+// scratch state owned by one render thread, picked by the pool's worker index
+struct ThreadContext {
+	std::vector<int> lastOccluder;  // per light, object that last blocked a shadow ray or -1
+	RenderStats stats;
+	// direct light and reflectance of every bounce of the path being shaded
+	std::vector<glm::vec3> bounceDirect;
+	std::vector<glm::vec3> bounceReflective;
+};
+
+/* The ray tracing core, kept free of any windowing or OpenGL calls so it can be
+   driven by the FLTK canvas as well as by the headless batch renderer.
+   Pixels are written as tightly packed RGB bytes, bottom row first (the layout
+   glDrawPixels expects). */
+class RayTracer {
+public:
+	SceneParser* parser;
+	SceneGlobalData globalSceneData;
+	std::vector<SceneObject> sceneObjects;
+
+	RayTracer();
+	~RayTracer();
+
+	// parses a scene file, returns false (and keeps no scene) if it is invalid
+	bool loadSceneFile(const char* filenamePath);
+	// points the camera the way the loaded scene file describes
+	void setupCamera(Camera* camera);
+	// flattens the scene graph and traces a width x height image into pixels
+	void render(Camera* camera, unsigned char* pixels, int width, int height, int recurseDepth, bool isectOnly);
+
+	/* The two halves of render(), for callers that trace several passes of one scene.
+	   prepareScene() only flattens and compiles the whole scene after a scene file was
+	   loaded or invalidateScene(); afterwards it just catches up with the nodes and
+	   primitives marked changed, or does nothing if only the camera moved. */
+	void prepareScene();
+	/* Traces the pixels on every step-th row and column, each one filling the step x step
+	   block it starts. refine skips the pixels a pass with 2 * step already traced, so
+	   passes of 8, 4, 2 and 1 end with the same image as one pass of 1. Returns false,
+	   leaving pixels half done, if *cancel became true (cancel may be NULL). */
+	bool renderPass(Camera* camera, unsigned char* pixels, int width, int height, int recurseDepth, bool isectOnly, int step, bool refine, const std::atomic<bool>* cancel);
+	/* Adaptive antialiasing on top of a finished full resolution pass into the same
+	   pixels: pixels whose object differs from a neighbour's or whose color contrasts
+	   with one get stratified samples, 4, then 16 and so on up to the sample budget
+	   while their samples keep disagreeing. Does nothing with a budget of 1. Its rays
+	   add to the stats of the pass before; returns false if *cancel became true. */
+	bool antialiasPass(const std::atomic<bool>* cancel);
+
+	// call after editing a node's transformations, the next prepareScene() re-flattens the subtrees below its instances
+	void nodeChanged(SceneNode* node);
+	// call after editing a primitive's material
+	void primitiveChanged(ScenePrimitive* primitive);
+	// anything else, like added or removed nodes, primitives or a new primitive type, needs everything redone
+	void invalidateScene() { sceneDirty = true; }
+
+	// samples per pixel the antialiasing pass may spend, rounded down to 1, 4, 16 or 64 (1 = off)
+	void setMaxSamples(int samples);
+	int getMaxSamples() { return maxSamples; }
+	/* Samples each pixel of the last frame got as an RGB image in the layout of pixels,
+	   from blue for one sample to red for the full budget. */
+	void sampleHeatmap(unsigned char* heatmap);
+
+	/* Shadow rays per spot light with a radius or area light, rounded down to 1, 4, 16
+	   or 64; with 1 they cast hard shadows from their center. Points that the first four
+	   find fully lit or fully shadowed stop there. */
+	void setLightSamples(int samples);
+	int getLightSamples() { return lightGrid * lightGrid; }
+
+	/* Russian roulette on reflection paths whose weight dropped below 0.1: they go on
+	   with a chance proportional to their weight and are made stronger by as much. Off
+	   by default, paths then only end at the depth limit or once too weak to show. */
+	void setRussianRoulette(bool enabled) { russianRoulette = enabled; }
+	bool getRussianRoulette() { return russianRoulette; }
+
+	/* Rays per pixel when the camera has an aperture (1 to 64, default 16). They are
+	   spread over the lens and the pixel alike, so the antialiasing pass is skipped
+	   then. With lens packets on, a pixel's samples go down the BVH together in one
+	   traversal order instead of each walking it alone. The image is the same; it is
+	   off by default because rays from all over the lens share fewer boxes than a row
+	   of pinhole rays and the packets came out slower in a4-bench. */
+	void setLensSamples(int samples);
+	int getLensSamples() { return lensSamples; }
+	void setLensPackets(bool enabled) { lensPackets = enabled; }
+	bool getLensPackets() { return lensPackets; }
+
+	void setNumThreads(int threads);
+	int getNumThreads() { return numThreads; }
+	// totals of the last render pass over all threads
+	RenderStats getRenderStats();
+
+	Shape* getShape(OBJ_TYPE type);
+	float renderShape(OBJ_TYPE type, glm::vec3 ray, const glm::mat4& inverseMatrix, glm::vec3 eyePoint);
+
+private:
+	// textures by file name, decoded before rendering starts and only read by the render threads
+	TextureStore textureStore;
+	// meshes by file name, kept across scene loads so each file's triangle BVH is only built once
+	std::unordered_map<std::string, Mesh*> meshCache;
+
+	void setpixel(unsigned char* buf, int x, int y, int r, int g, int b);
+	void loadTextures();
+	void loadMeshes();
+	Mesh* findMesh(const ScenePrimitive* primitive);
+	void renderTile(int tileIndex, const glm::vec3& eyePoint, ThreadContext& context);
+	void fillBlock(int x, int y, int endX, int endY, int r, int g, int b, int object);
+	glm::vec3 lensPixel(int x, int y, int& object, ThreadContext& context);
+	void antialiasTile(int tileIndex, const glm::vec3& eyePoint, ThreadContext& context);
+	bool isEdgePixel(int x, int y);
+	glm::vec3 supersamplePixel(int x, int y, const glm::vec3& eyePoint, int& sampleCount, ThreadContext& context);
+	glm::vec3 traceSample(const glm::vec3& eyePoint, float x, float y, ThreadContext& context);
+
+	float attenuation(const LightRecord& light, float distance);
+	float maxAttenuation(const LightRecord& light, const glm::vec3& point);
+	float spotFactor(const LightRecord& light, const glm::vec3& point);
+	glm::vec3 emitterPoint(const LightRecord& light, int k, const glm::vec3& point);
+	glm::vec3 calculateObjectLighting(const MaterialRecord& material, glm::vec3 objNormal, glm::vec3 worldSpacePos, glm::vec3 textureMap, glm::vec3 viewOrigin, ThreadContext& context);
+
+	void traverseSceneGraph(SceneNode* node, const glm::mat4& parentTransform);
+	bool updateScene();
+	bool reflattenSubtree(int visit, const glm::mat4& parentTransform, std::vector<int>& changed);
+	void clearChanges();
+	MaterialRecord compileMaterial(const SceneMaterial& source);
+	glm::vec3 shadeIntersection(const glm::vec3& origin, const glm::vec3& ray, const IntersectionInfo& firstHit, int maxDepth, ThreadContext& context);
+	glm::vec3 surfaceColor(const glm::vec3& origin, const IntersectionInfo& isect, float footprint, ThreadContext& context);
+	glm::vec2 uvFootprint(const IntersectionInfo& isect, const glm::vec3& dir, float footprint, const glm::mat4& inverseMatrix, glm::vec2 uv);
+	float rouletteSample(const glm::vec3& dir, int depth);
+	IntersectionInfo findClosestIntersection(const glm::vec3& origin, const glm::vec3& ray);
+	IntersectionInfo makeIntersection(const glm::vec3& origin, const glm::vec3& ray, int hitIndex, float t);
+	int findClosestObject(const glm::vec3& origin, const glm::vec3& ray, float& t);
+	void findClosestObjects(const RayPacket<PACKET_SIZE>& rays, float* t, int* hitIndex);
+	void intersectPacket(int object, const RayPacket<PACKET_SIZE>& rays, float* t);
+	AABB getWorldBounds(const SceneObject& object);
+	void buildBVH();
+	void compileScene();
+	bool isInShadow(const glm::vec3& point, const glm::vec3& lightDir, float lightDistance, int lightIndex, ThreadContext& context);
+	float intersect(int object, const glm::vec3& origin, const glm::vec3& dir);
+	bool occludes(int object, const glm::vec3& origin, const glm::vec3& dir, float maxDistance);
+
+	Cube* cube;
+	Cylinder* cylinder;
+	Cone* cone;
+	Sphere* sphere;
+	Torus* torus;
+
+	BVH bvh;
+	std::vector<AABB> objectBounds;     // per object, what the BVH was built or last refit with
+	CompiledScene compiledScene;    // what the render threads read instead of sceneObjects
+
+	// what incremental updates need to find their way back into the flattened scene
+	bool sceneDirty;        // a full flatten is due
+	int updatedObjects;     // see RenderStats::updatedObjects
+	std::vector<FlattenedNode> flattenedNodes;
+	std::unordered_map<SceneNode*, std::vector<int> > nodeVisits;
+	std::unordered_map<const ScenePrimitive*, int> materialIndices;
+	std::vector<SceneNode*> changedNodes;
+	std::vector<ScenePrimitive*> changedPrimitives;
+	ThreadPool* threadPool;
+	int numThreads;         // size of the render thread pool, 0 = one per core
+	std::vector<ThreadContext> threadContexts;  // one per pool worker
+
+	// state of the frame being rendered, read-only while the tiles are traced
+	Camera* camera;
+	RayGenerator rayGenerator;
+	float pixelSpread;      // width of a pixel's ray cone one unit from the eye
+	unsigned char* pixels;
+	int pixelWidth, pixelHeight;
+	int recurseDepth;
+	bool isectOnly;
+	int passStep;
+	bool refinePass;
+	const std::atomic<bool>* cancelFlag;
+
+	int maxSamples;
+	int lightGrid;      // soft shadows take lightGrid x lightGrid samples per light
+	bool russianRoulette;
+	int lensSamples;
+	bool lensPackets;
+	bool autoFocus;     // the scene gives no focal distance, each frame focuses on what the view ray hits
+	std::vector<int> pixelObjects;              // object seen through each pixel or -1, for edge detection
+	std::vector<unsigned char> basePixels;      // the one sample image the antialiasing pass compares
+	std::vector<unsigned char> sampleCounts;    // per pixel, written by the antialiasing pass
+};
+
+#endif
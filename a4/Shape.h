@@ -1,11 +1,11 @@
 	#ifndef SHAPE_H
 #define SHAPE_H
 
-#include <FL/gl.h>
-#include <FL/glu.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include "RayPacket.h"
+
 #define PI glm::pi<float>()  //PI is now a constant for 3.14159....
 
 enum OBJ_TYPE {
@@ -36,20 +36,12 @@ public:
 
 	virtual OBJ_TYPE getType() = 0;
 	virtual void draw() {};
-	virtual float draw(glm::vec3 eyePoint, glm::vec3 ray, glm::mat4 transformMatrix) { return 0.0f;  };
+	// inverseMatrix is the world to object matrix, precomputed once per object by the scene flattening
+	virtual float draw(glm::vec3 eyePoint, glm::vec3 ray, const glm::mat4& inverseMatrix) { return 0.0f;  };
 	//virtual glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 ray, glm::mat4 transformMatrix, double t) { return glm::vec3(0.0f, 0.0f, 0.0f); };
-	virtual glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, glm::mat4 transformMatrix, double t) { return glm::vec3(0.0f, 0.0f, 0.0f); };
+	// normalMatrix is transpose(mat3(inverseMatrix)), it maps object space normals to world space
+	virtual glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, const glm::mat4& inverseMatrix, const glm::mat3& normalMatrix, double t) { return glm::vec3(0.0f, 0.0f, 0.0f); };
 	virtual glm::vec2 getUVCoordinates(glm::vec3 ray) { return glm::vec2(1.0f, 1.0f); }
-
-protected:
-	void normalizeNormal (float x, float y, float z) {
-		normalizeNormal (glm::vec3(x, y, z));
-	};
-
-	void normalizeNormal (glm::vec3 v) {
-		glm::vec3 tmpV = glm::normalize(v);
-		glNormal3f(tmpV.x, tmpV.y, tmpV.z);
-	};
 };
 
 #endif
\ No newline at end of file
@@ -46,10 +46,10 @@ public:
     //     return glm::vec2(u, v);
     // }
 
-	float draw(glm::vec3 eyePoint, glm::vec3 ray, glm::mat4 transformMatrix) {
+	float draw(glm::vec3 eyePoint, glm::vec3 ray, const glm::mat4& inverseMatrix) {
 	/*	std::cout << "IN SPHERE DRAW" << "\n";
 		std::cout << ray.x << "\n";*/
-		float t = intersect(eyePoint, ray, transformMatrix);
+		float t = intersect(eyePoint, ray, inverseMatrix);
 		return t;
 	};
 
@@ -75,19 +75,14 @@ public:
  //       return worldNormal;
  //   }
 
-	glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, glm::mat4 transformMatrix, double t) {
-		glm::mat4 inverseMatrix = glm::inverse(transformMatrix);
-		// Convert eye point to object space - should use w=1.0 for points
-		glm::vec4 objP = inverseMatrix * glm::vec4(eyePoint, 1.0f);
+	glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, const glm::mat4& inverseMatrix, const glm::mat3& normalMatrix, double t) {
 		// Convert ray to object space - should use w=0.0 for vectors
 		glm::vec4 intersectPoint = inverseMatrix * glm::vec4(worldSpacePos, 1.0f);
 
 		// For a sphere, the normal is just the normalized point (since it's centered at origin)
 		glm::vec3 normalObj = glm::normalize(intersectPoint);
 
-		// Transform normal to world coordinates using the normal transform matrix
-		// For normals, we need to use the transpose of the inverse of the 3x3 part
-		glm::mat3 normalMatrix = glm::transpose(glm::mat3(inverseMatrix));
+		// Transform normal to world coordinates using the precomputed normal matrix
 		glm::vec3 worldNormal = glm::normalize(normalMatrix * normalObj);
 
 		return worldNormal;
@@ -103,8 +98,7 @@ public:
 	(1) a -1 if no intersection is found
 	(2) OR, the "t" value which is the distance from the origin of the ray to the (nearest) intersection point on the sphere
 */
-	float intersect(glm::vec3 eyePointP, glm::vec3 rayV, glm::mat4 transformMatrix) {
-		glm::mat4 inverseMatrix = glm::inverse(transformMatrix);
+	float intersect(glm::vec3 eyePointP, glm::vec3 rayV, const glm::mat4& inverseMatrix) {
 
 		// Convert to object space
 		glm::vec4 objP = inverseMatrix * glm::vec4(eyePointP, 1.0f);
@@ -145,6 +139,25 @@ public:
 		return std::min(t1, t2);
 	}
 
+	// packet version of intersect(), writes t or -1 for every lane of rays to tOut
+	template <int N>
+	void intersectPacket(const RayPacket<N>& rays, const glm::mat4& inverseMatrix, float* tOut) {
+		ObjectSpacePacket<N> obj(rays, inverseMatrix);
+		for (int i = 0; i < N; i++) {
+			float A = (obj.dx[i] * obj.dx[i] + obj.dy[i] * obj.dy[i]) + obj.dz[i] * obj.dz[i];
+			float B = 2.0f * ((obj.Px[i] * obj.dx[i] + obj.Py[i] * obj.dy[i]) + obj.Pz[i] * obj.dz[i]);
+			float C = ((obj.Px[i] * obj.Px[i] + obj.Py[i] * obj.Py[i]) + obj.Pz[i] * obj.Pz[i]) - 0.25f;
+			float discriminant = (B * B) - (4.0f * A * C);
+
+			// auto keeps whichever sqrt overload intersect() gets, so both round the same way
+			auto root = sqrt(discriminant >= 0 ? discriminant : 0.0f);
+			float t1 = (-B + root) / (2.0f * A);
+			float t2 = (-B - root) / (2.0f * A);
+			float t = (t1 < 0 && t2 < 0) ? -1.0f : (t1 < 0) ? t2 : (t2 < 0) ? t1 : std::min(t1, t2);
+			tOut[i] = discriminant < 0 ? -1.0f : t;
+		}
+	}
+
 private:
 };
 
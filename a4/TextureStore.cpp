@@ -0,0 +1,129 @@
+#include "TextureStore.h"
+#include "ppm.h"
+#include "Profiler.h"
+
+#include <cmath>
+#include <algorithm>
+
+TextureStore::TextureStore() {
+}
+
+TextureStore::~TextureStore() {
+}
+
+void TextureStore::Level::resize(int width, int height) {
+	this->width = width;
+	this->height = height;
+	tilesX = (width + TILE - 1) / TILE;
+	int tilesY = (height + TILE - 1) / TILE;
+	texels.assign(tilesX * tilesY * TILE * TILE, glm::vec3(0.0f));
+}
+
+int TextureStore::load(const std::string& fileName) {
+	auto found = handles.find(fileName);
+	if (found != handles.end()) {
+		return found->second;
+	}
+	PROFILE_COUNT(COUNTER_TEXTURE_CACHE_MISSES);
+
+	ppm image(fileName);
+	const char* pixels = image.getPixels();
+	int width = image.getWidth();
+	int height = image.getHeight();
+	if (pixels == NULL || width <= 0 || height <= 0) {
+		handles[fileName] = -1;
+		return -1;
+	}
+
+	Texture texture;
+	texture.levels.push_back(Level());
+	Level& top = texture.levels.back();
+	top.resize(width, height);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			const char* color = pixels + (y * width + x) * 3;
+			top.texel(x, y) = glm::vec3((unsigned char)color[0], (unsigned char)color[1], (unsigned char)color[2]) / 255.0f;
+		}
+	}
+	while (texture.levels.back().width > 1 || texture.levels.back().height > 1) {
+		Level next;
+		downsample(texture.levels.back(), next);
+		texture.levels.push_back(next);
+	}
+
+	int handle = (int)textures.size();
+	textures.push_back(texture);
+	handles[fileName] = handle;
+	return handle;
+}
+
+int TextureStore::find(const std::string& fileName) const {
+	auto found = handles.find(fileName);
+	return found == handles.end() ? -1 : found->second;
+}
+
+void TextureStore::clear() {
+	textures.clear();
+	handles.clear();
+}
+
+// halves both sides, every texel is the mean of the 2x2 block above it. An odd last row or column is left out
+void TextureStore::downsample(const Level& source, Level& target) {
+	target.resize(std::max(1, source.width / 2), std::max(1, source.height / 2));
+	for (int y = 0; y < target.height; y++) {
+		int y0 = std::min(y * 2, source.height - 1);
+		int y1 = std::min(y * 2 + 1, source.height - 1);
+		for (int x = 0; x < target.width; x++) {
+			int x0 = std::min(x * 2, source.width - 1);
+			int x1 = std::min(x * 2 + 1, source.width - 1);
+			target.texel(x, y) = (source.texel(x0, y0) + source.texel(x1, y0) + source.texel(x0, y1) + source.texel(x1, y1)) * 0.25f;
+		}
+	}
+}
+
+// s and t in [0, 1) from the top left corner, texel centers sit at half texels and the edges wrap
+glm::vec3 TextureStore::bilinear(const Level& level, float s, float t) {
+	float x = s * level.width - 0.5f;
+	float y = t * level.height - 0.5f;
+	float fx = std::floor(x);
+	float fy = std::floor(y);
+	float ax = x - fx;
+	float ay = y - fy;
+
+	int x0 = (int)fx;
+	int y0 = (int)fy;
+	int x1 = x0 + 1;
+	int y1 = y0 + 1;
+	if (x0 < 0) x0 += level.width;
+	if (y0 < 0) y0 += level.height;
+	if (x1 >= level.width) x1 -= level.width;
+	if (y1 >= level.height) y1 -= level.height;
+
+	glm::vec3 top = glm::mix(level.texel(x0, y0), level.texel(x1, y0), ax);
+	glm::vec3 bottom = glm::mix(level.texel(x0, y1), level.texel(x1, y1), ax);
+	return glm::mix(top, bottom, ay);
+}
+
+glm::vec3 TextureStore::sample(int handle, glm::vec2 uv, glm::vec2 footprint) const {
+	const Texture& texture = textures[handle];
+	float s = uv.x - std::floor(uv.x);
+	float t = 1.0f - (uv.y - std::floor(uv.y));
+	// s can round up to exactly 1 and t is 1 at v = 0, both belong to the other edge
+	if (s >= 1.0f) s = 0.0f;
+	if (t >= 1.0f) t = 0.0f;
+
+	const Level& top = texture.levels[0];
+	float texels = std::max(std::fabs(footprint.x) * top.width, std::fabs(footprint.y) * top.height);
+	if (!(texels > 1.0f)) {
+		return bilinear(top, s, t);
+	}
+
+	float lod = std::min(std::log2(texels), (float)(texture.levels.size() - 1));
+	int level = (int)lod;
+	float fraction = lod - level;
+	glm::vec3 color = bilinear(texture.levels[level], s, t);
+	if (fraction > 0.0f && level + 1 < (int)texture.levels.size()) {
+		color = glm::mix(color, bilinear(texture.levels[level + 1], s, t), fraction);
+	}
+	return color;
+}
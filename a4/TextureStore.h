@@ -0,0 +1,65 @@
+#ifndef TEXTURESTORE_H
+#define TEXTURESTORE_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/* Every texture a scene uses, decoded once when the scene loads and looked up by an
+   integer handle while rendering. Texels are stored as floats in [0, 1], the same
+   values the byte colors stood for, in 4x4 tiles so the four texels of a bilinear
+   lookup almost always share a tile. Each texture carries a box filtered mip chain
+   down to 1x1.
+
+   Loading is not thread safe; sampling is, once the scene is loaded. */
+class TextureStore {
+public:
+	TextureStore();
+	~TextureStore();
+
+	// decodes the ppm file once, later calls return the same handle. -1 if it can't be read
+	int load(const std::string& fileName);
+	// handle of a file that was loaded before, -1 otherwise
+	int find(const std::string& fileName) const;
+	void clear();
+
+	/* Color at uv, which wraps around and has v running bottom to top like the shapes'
+	   uv coordinates. footprint is the extent of the lookup in uv units; up to a texel
+	   the top level is filtered bilinearly, larger footprints blend the two closest
+	   mip levels (trilinear). */
+	glm::vec3 sample(int handle, glm::vec2 uv, glm::vec2 footprint) const;
+
+	int getWidth(int handle) const { return textures[handle].levels[0].width; }
+	int getHeight(int handle) const { return textures[handle].levels[0].height; }
+	int getLevelCount(int handle) const { return (int)textures[handle].levels.size(); }
+
+private:
+	static const int TILE = 4;
+
+	struct Level {
+		int width, height;
+		int tilesX;
+		std::vector<glm::vec3> texels;  // tile by tile, row by row inside a tile, top row first
+
+		const glm::vec3& texel(int x, int y) const {
+			return texels[((y / TILE) * tilesX + x / TILE) * TILE * TILE + (y % TILE) * TILE + x % TILE];
+		}
+		glm::vec3& texel(int x, int y) {
+			return texels[((y / TILE) * tilesX + x / TILE) * TILE * TILE + (y % TILE) * TILE + x % TILE];
+		}
+		void resize(int width, int height);
+	};
+
+	struct Texture {
+		std::vector<Level> levels;
+	};
+
+	static glm::vec3 bilinear(const Level& level, float s, float t);
+	static void downsample(const Level& source, Level& target);
+
+	std::vector<Texture> textures;
+	std::unordered_map<std::string, int> handles;   // files that failed to load map to -1
+};
+
+#endif
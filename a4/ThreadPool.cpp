@@ -0,0 +1,104 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int numThreads) {
+	if (numThreads <= 0) {
+		numThreads = defaultThreadCount();
+	}
+	currentTask = NULL;
+	generation = 0;
+	activeWorkers = 0;
+	stopping = false;
+
+	for (int i = 0; i < numThreads; i++) {
+		queues.push_back(new WorkQueue());
+	}
+	for (int i = 0; i < numThreads; i++) {
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(stateLock);
+		stopping = true;
+	}
+	startCondition.notify_all();
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	for (size_t i = 0; i < queues.size(); i++) {
+		delete queues[i];
+	}
+}
+
+int ThreadPool::defaultThreadCount() {
+	int count = (int)std::thread::hardware_concurrency();
+	return count > 0 ? count : 1;
+}
+
+void ThreadPool::run(int numTasks, const std::function<void(int, int)>& task) {
+	if (numTasks <= 0) return;
+
+	// deal tasks out round robin so neighbouring tiles start on different threads
+	for (int i = 0; i < numTasks; i++) {
+		WorkQueue* queue = queues[i % queues.size()];
+		std::lock_guard<std::mutex> guard(queue->lock);
+		queue->tasks.push_back(i);
+	}
+
+	std::unique_lock<std::mutex> guard(stateLock);
+	currentTask = &task;
+	activeWorkers = (int)workers.size();
+	generation++;
+	startCondition.notify_all();
+	doneCondition.wait(guard, [this]() { return activeWorkers == 0; });
+	currentTask = NULL;
+}
+
+bool ThreadPool::popTask(int workerIndex, int& taskIndex) {
+	// own queue first, oldest task first
+	{
+		WorkQueue* own = queues[workerIndex];
+		std::lock_guard<std::mutex> guard(own->lock);
+		if (!own->tasks.empty()) {
+			taskIndex = own->tasks.front();
+			own->tasks.pop_front();
+			return true;
+		}
+	}
+	// then steal from the far end of somebody else's queue
+	for (size_t i = 1; i < queues.size(); i++) {
+		WorkQueue* victim = queues[(workerIndex + i) % queues.size()];
+		std::lock_guard<std::mutex> guard(victim->lock);
+		if (!victim->tasks.empty()) {
+			taskIndex = victim->tasks.back();
+			victim->tasks.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::workerLoop(int workerIndex) {
+	unsigned int seenGeneration = 0;
+	while (true) {
+		const std::function<void(int, int)>* task;
+		{
+			std::unique_lock<std::mutex> guard(stateLock);
+			startCondition.wait(guard, [&]() { return stopping || generation != seenGeneration; });
+			if (stopping) return;
+			seenGeneration = generation;
+			task = currentTask;
+		}
+
+		int taskIndex;
+		while (popTask(workerIndex, taskIndex)) {
+			(*task)(taskIndex, workerIndex);
+		}
+
+		std::lock_guard<std::mutex> guard(stateLock);
+		if (--activeWorkers == 0) {
+			doneCondition.notify_all();
+		}
+	}
+}
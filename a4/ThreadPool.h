@@ -0,0 +1,51 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/* Fixed size pool of worker threads with one task queue per worker.
+   run() deals the task indices out round robin, each worker drains its own queue
+   from the front and, once it is empty, steals from the back of the other queues,
+   so uneven tiles (busy foreground vs. empty background) still balance out. */
+class ThreadPool {
+public:
+	// numThreads <= 0 uses one thread per hardware core
+	ThreadPool(int numThreads);
+	~ThreadPool();
+
+	int size() const { return (int)workers.size(); }
+
+	/* Calls task(taskIndex, workerIndex) for every taskIndex in [0, numTasks) and
+	   blocks until all of them have finished. workerIndex is in [0, size()) and can
+	   be used to pick per-thread scratch state. */
+	void run(int numTasks, const std::function<void(int, int)>& task);
+
+	static int defaultThreadCount();
+
+private:
+	struct WorkQueue {
+		std::mutex lock;
+		std::deque<int> tasks;
+	};
+
+	void workerLoop(int workerIndex);
+	bool popTask(int workerIndex, int& taskIndex);
+
+	std::vector<std::thread> workers;
+	std::vector<WorkQueue*> queues;
+
+	std::mutex stateLock;
+	std::condition_variable startCondition;
+	std::condition_variable doneCondition;
+	const std::function<void(int, int)>* currentTask;
+	unsigned int generation;    // bumped for every run() so sleeping workers know there is new work
+	int activeWorkers;
+	bool stopping;
+};
+
+#endif
@@ -1,12 +1,20 @@
 #ifndef TORUS_H
 #define TORUS_H
 
+#include <cmath>
+#include <algorithm>
+
 #include "Shape.h"
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
+/* Ring torus around the z axis, the same one a3 tessellated: the tube of radius
+   TUBE_RADIUS is centered RING_RADIUS from the axis, so the torus just fits the
+   unit cube in x and y. Rays are intersected analytically by solving the quartic
+   in double precision. */
 class Torus : public Shape {
 public:
+	static constexpr float RING_RADIUS = 0.35f;
+	static constexpr float TUBE_RADIUS = 0.15f;
+
 	Torus() {};
 	~Torus() {};
 
@@ -14,148 +22,241 @@ public:
 		return SHAPE_SPECIAL1;
 	}
 
-	void draw() {
-		glPushMatrix();
-		glRotatef(90, 1, 0, 0);
-		drawBody();
-		glPopMatrix();
-	};
-
-	void drawNormal() {
-		glPushMatrix();
-		glRotatef(90, 1, 0, 0);
-		drawBodyNormal();
-		glPopMatrix();
-	};
-
-	float Intersect(glm::vec3 eyePointP, glm::vec3 rayV, glm::mat4 transformMatrix) {
-		float t = MIN_ISECT_DISTANCE;
-		return t;
+	// u runs around the axis, v around the tube starting at its outer equator
+	glm::vec2 getUVCoordinates(glm::vec3 point) {
+		float u = (atan2(point.y, point.x) + PI) / (2.0f * PI);
+		float ringDistance = sqrt(point.x * point.x + point.y * point.y) - RING_RADIUS;
+		float v = (atan2(point.z, ringDistance) + PI) / (2.0f * PI);
+		return glm::vec2(u, v);
+	}
+
+	float draw(glm::vec3 eyePoint, glm::vec3 ray, const glm::mat4& inverseMatrix) {
+		return intersect(eyePoint, ray, inverseMatrix);
+	}
+
+	// the normal points from the closest point on the ring circle to the hit
+	glm::vec3 drawNormal(glm::vec3 eyePoint, glm::vec3 worldSpacePos, const glm::mat4& inverseMatrix, const glm::mat3& normalMatrix, double t) {
+		glm::vec3 p = glm::vec3(inverseMatrix * glm::vec4(worldSpacePos, 1.0f));
+		float axisDistance = sqrt(p.x * p.x + p.y * p.y);
+		glm::vec3 ringPoint(0.0f);
+		if (axisDistance > 0.0f) {
+			ringPoint = glm::vec3(p.x, p.y, 0.0f) * (RING_RADIUS / axisDistance);
+		}
+		return glm::normalize(normalMatrix * (p - ringPoint));
+	}
+
+	/* Returns -1 if the ray misses, otherwise the smallest positive t. The ray is first
+	   tested against the bounding sphere (radius RING_RADIUS + TUBE_RADIUS); a hit moves
+	   the origin up to where it enters the sphere and the quartic is solved in unit
+	   length steps from there, which keeps the coefficients small. */
+	float intersect(glm::vec3 eyePointP, glm::vec3 rayV, const glm::mat4& inverseMatrix) {
+		glm::vec4 objP = inverseMatrix * glm::vec4(eyePointP, 1.0f);
+		glm::vec4 objRay = inverseMatrix * glm::vec4(rayV, 0.0f);
+
+		double ox = objP.x, oy = objP.y, oz = objP.z;
+		double dx = objRay.x, dy = objRay.y, dz = objRay.z;
+		double length = sqrt(dx * dx + dy * dy + dz * dz);
+		if (length == 0.0) return -1;
+		dx /= length;
+		dy /= length;
+		dz /= length;
+
+		// bounding sphere reject
+		const double outer = RING_RADIUS + TUBE_RADIUS;
+		double b = ox * dx + oy * dy + oz * dz;
+		double c = ox * ox + oy * oy + oz * oz - outer * outer;
+		double disc = b * b - c;
+		if (disc < 0.0) return -1;
+		double root = sqrt(disc);
+		double sphereExit = -b + root;
+		if (sphereExit <= 0.0) return -1;
+		double start = std::max(0.0, -b - root);
+		ox += start * dx;
+		oy += start * dy;
+		oz += start * dz;
+
+		// (|p|^2 + R^2 - r^2)^2 = 4 R^2 (px^2 + py^2) with p = o + s d and |d| = 1
+		const double R2 = (double)RING_RADIUS * RING_RADIUS;
+		const double r2 = (double)TUBE_RADIUS * TUBE_RADIUS;
+		double n = ox * dx + oy * dy + oz * dz;
+		double k = ox * ox + oy * oy + oz * oz + R2 - r2;
+		double coeffs[5];
+		coeffs[4] = 1.0;
+		coeffs[3] = 4.0 * n;
+		coeffs[2] = 4.0 * n * n + 2.0 * k - 4.0 * R2 * (dx * dx + dy * dy);
+		coeffs[1] = 4.0 * n * k - 8.0 * R2 * (ox * dx + oy * dy);
+		coeffs[0] = k * k - 4.0 * R2 * (ox * ox + oy * oy);
+
+		double roots[4];
+		int count = solveQuartic(coeffs, roots);
+		double best = -1.0;
+		for (int i = 0; i < count; i++) {
+			double s = polishRoot(coeffs, roots[i]);
+			// only the stretch inside the bounding sphere can hold a hit
+			if (s + start > 0.0 && s <= sphereExit - start + 1e-6 && (best < 0.0 || s < best)) {
+				best = s;
+			}
+		}
+		if (best < 0.0) return -1;
+		return (float)((best + start) / length);
 	}
 
-	glm::vec3 findIsectNormal(glm::vec3 eyePoint, glm::vec3 ray, float dist) {
-		glm::vec3 normalVector(0.0f, 0.0f, 0.0f);
-		return normalVector;
+	// the quartic doesn't vectorize well, so the packet path runs the scalar test per lane
+	template <int N>
+	void intersectPacket(const RayPacket<N>& rays, const glm::mat4& inverseMatrix, float* tOut) {
+		for (int i = 0; i < N; i++) {
+			tOut[i] = intersect(rays.origin(i), rays.dir(i), inverseMatrix);
+		}
 	}
 
 private:
+	// below this a coefficient or discriminant counts as zero
+	static bool isZero(double x) {
+		return x > -1e-12 && x < 1e-12;
+	}
+
+	// c[0] + c[1] x + c[2] x^2 = 0 with c[2] = 1, returns the number of real roots
+	static int solveQuadratic(const double c[3], double s[2]) {
+		double p = c[1] / 2.0;
+		double D = p * p - c[0];
+		if (isZero(D)) {
+			s[0] = -p;
+			return 1;
+		}
+		if (D < 0.0) return 0;
+		double root = sqrt(D);
+		s[0] = -p - root;
+		s[1] = -p + root;
+		return 2;
+	}
+
+	// c[0] + c[1] x + c[2] x^2 + x^3 = 0 by Cardano, or the trigonometric form for three roots
+	static int solveCubic(const double c[4], double s[3]) {
+		double A = c[2];
+		double B = c[1];
+		double C = c[0];
+
+		// x = y - A/3 removes the quadratic term: y^3 + 3p y + 2q = 0
+		double sqA = A * A;
+		double p = (-sqA / 3.0 + B) / 3.0;
+		double q = (2.0 / 27.0 * A * sqA - A * B / 3.0 + C) / 2.0;
+		double cbp = p * p * p;
+		double D = q * q + cbp;
 
-	void drawBody() {
-		float radius = 0.15;
-		float radiusRing = 0.5;
-		float angle_delta = 2 * PI / (float)m_segmentsX;
-		float angleRing_delta = 2 * PI / (float)m_segmentsY;
-
-		float angleRing = 0;
-
-		glBegin(GL_TRIANGLES);
-		for (int i = 0; i < m_segmentsY; i++) {
-			float angle = 0;
-			for (int j = 0; j < m_segmentsX; j++) {
-				glm::vec4 origin(0, 0, 0, 1.0f);
-				glm::vec4 p (radius, 0, 0, 1.0f);
-				glm::mat4 rotZmat = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f));
-				glm::vec4 pt = rotZmat * p;
-				glm::mat4 rotZmat2 = glm::rotate(glm::mat4(1.0f), angle+angle_delta, glm::vec3(0.0f, 0.0f, 1.0f));
-				glm::vec4 newPt = rotZmat2 * p;
-
-				glm::mat4 translate = glm::translate(glm::mat4(1.0f), glm::vec3(radiusRing - radius, 0, 0));
-				glm::mat4 rotY = glm::rotate(glm::mat4(1.0f), angleRing, glm::vec3(0, 1, 0));
-				glm::mat4 transform1 = rotY * translate;
-
-				glm::vec4 origin_ring = transform1 * origin;
-				glm::vec4 pt_ring =  transform1 * pt;
-				glm::vec4 newPt_ring = transform1 * newPt;
-
-				glm::mat4 rotY2 = glm::rotate(glm::mat4(1.0f), angleRing + angleRing_delta, glm::vec3(0, 1, 0));
-				glm::mat4 transform2 = rotY2 * translate;
-
-				glm::vec4 origin_ring_next = transform2 * origin;
-				glm::vec4 pt_ring_next =  transform2 * pt;
-				glm::vec4 newPt_ring_next = transform2  * newPt;
-
-				normalizeNormal(newPt_ring_next - origin_ring_next);
-				glVertex3d(newPt_ring_next.x, newPt_ring_next.y, newPt_ring_next.z);
-				normalizeNormal(newPt_ring - origin_ring);
-				glVertex3d(newPt_ring.x, newPt_ring.y, newPt_ring.z);
-				normalizeNormal(pt_ring - origin_ring);
-				glVertex3d(pt_ring.x, pt_ring.y, pt_ring.z);
-
-				normalizeNormal(pt_ring_next - origin_ring_next);
-				glVertex3d(pt_ring_next.x, pt_ring_next.y, pt_ring_next.z);
-				normalizeNormal(newPt_ring_next - origin_ring_next);
-				glVertex3d(newPt_ring_next.x, newPt_ring_next.y, newPt_ring_next.z);
-				normalizeNormal(pt_ring - origin_ring);
-				glVertex3d(pt_ring.x, pt_ring.y, pt_ring.z);
-
-				angle = angle + angle_delta;
+		int count;
+		if (isZero(D)) {
+			if (isZero(q)) {
+				s[0] = 0.0;
+				count = 1;
 			}
-			angleRing = angleRing + angleRing_delta;
+			else {
+				double u = cbrt(-q);
+				s[0] = 2.0 * u;
+				s[1] = -u;
+				count = 2;
+			}
+		}
+		else if (D < 0.0) {
+			double phi = acos(std::max(-1.0, std::min(1.0, -q / sqrt(-cbp)))) / 3.0;
+			double t = 2.0 * sqrt(-p);
+			s[0] = t * cos(phi);
+			s[1] = -t * cos(phi + M_PI / 3.0);
+			s[2] = -t * cos(phi - M_PI / 3.0);
+			count = 3;
+		}
+		else {
+			double root = sqrt(D);
+			s[0] = cbrt(root - q) - cbrt(root + q);
+			count = 1;
 		}
-		glEnd();
-	};
-
-	void drawBodyNormal() {
-
-		float radius = 0.15;
-		float radiusRing = 0.5;
-		float angle_delta = 2 * PI / (float)m_segmentsX;
-		float angleRing_delta = 2 * PI / (float)m_segmentsY;
-
-		glBegin(GL_LINES);
-		float angleRing = 0;
-		for (int i = 0; i < m_segmentsY; i++) {
-			float angle = 0;
-			for (int j = 0; j < m_segmentsX; j++) {
-				glm::vec4 origin(0, 0, 0, 1.0f);
-				glm::vec4 p(radius, 0, 0, 1.0f);
-				glm::mat4 rotZmat = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f));
-				glm::vec4 pt = rotZmat * p;
-				glm::mat4 rotZmat2 = glm::rotate(glm::mat4(1.0f), angle + angle_delta, glm::vec3(0.0f, 0.0f, 1.0f));
-				glm::vec4 newPt = rotZmat2 * p;
-
-				glm::mat4 translate = glm::translate(glm::mat4(1.0f), glm::vec3(radiusRing - radius, 0, 0));
-				glm::mat4 rotY = glm::rotate(glm::mat4(1.0f), angleRing, glm::vec3(0, 1, 0));
-				glm::mat4 transform1 = rotY * translate;
-
-				glm::vec4 origin_ring = transform1 * origin;
-				glm::vec4 pt_ring = transform1 * pt;
-				glm::vec4 newPt_ring = transform1 * newPt;
-
-				glm::mat4 rotY2 = glm::rotate(glm::mat4(1.0f), angleRing + angleRing_delta, glm::vec3(0, 1, 0));
-				glm::mat4 transform2 = rotY2 * translate;
-
-				glm::vec4 origin_ring_next = transform2 * origin;
-				glm::vec4 pt_ring_next = transform2 * pt;
-				glm::vec4 newPt_ring_next = transform2 * newPt;
-
-				glm::vec4 v = pt_ring - origin_ring;
-
-				v = normalize(v);
-				glVertex3d(pt_ring.x, pt_ring.y, pt_ring.z); glVertex4fv(glm::value_ptr(pt_ring+v*0.1f));
-				v = newPt_ring - origin_ring;
-				v = normalize(v);
-				glVertex4fv(glm::value_ptr(newPt_ring)); glVertex4fv(glm::value_ptr(newPt_ring+v*0.1f)); 
-				v = newPt_ring_next - origin_ring_next;
-				v = normalize(v);
-				glVertex4fv(glm::value_ptr(newPt_ring_next)); glVertex4fv(glm::value_ptr(newPt_ring_next+v*0.1f)); 
-
-				v = (newPt_ring_next - origin_ring_next);
-				v = normalize(v);
-				glVertex4fv(glm::value_ptr(newPt_ring_next)); glVertex4fv(glm::value_ptr(newPt_ring_next + v * 0.1f));
-				v = (pt_ring_next - origin_ring_next);
-				v= normalize(v);
-				glVertex4fv(glm::value_ptr(pt_ring_next)); glVertex4fv(glm::value_ptr(pt_ring_next+v*0.1f)); 
-				v = (pt_ring - origin_ring);
-				v = normalize(v);
-				glVertex4fv(glm::value_ptr(pt_ring)); glVertex4fv(glm::value_ptr(pt_ring+v*0.1f)); 
-
-				angle = angle + angle_delta;
+
+		for (int i = 0; i < count; i++) {
+			s[i] -= A / 3.0;
+		}
+		return count;
+	}
+
+	// c[0] + c[1] x + ... + x^4 = 0 by Ferrari's method, returns the number of real roots
+	static int solveQuartic(const double c[5], double s[4]) {
+		double A = c[3];
+		double B = c[2];
+		double C = c[1];
+		double D = c[0];
+
+		// x = y - A/4 removes the cubic term: y^4 + p y^2 + q y + r = 0
+		double sqA = A * A;
+		double p = -3.0 / 8.0 * sqA + B;
+		double q = sqA * A / 8.0 - A * B / 2.0 + C;
+		double r = -3.0 / 256.0 * sqA * sqA + sqA * B / 16.0 - A * C / 4.0 + D;
+
+		int count;
+		double coeffs[4];
+		if (isZero(r)) {
+			// y (y^3 + p y + q) = 0
+			coeffs[0] = q;
+			coeffs[1] = p;
+			coeffs[2] = 0.0;
+			coeffs[3] = 1.0;
+			count = solveCubic(coeffs, s);
+			s[count++] = 0.0;
+		}
+		else {
+			// any real root z of the resolvent cubic splits the quartic into two quadratics
+			coeffs[0] = r * p / 2.0 - q * q / 8.0;
+			coeffs[1] = -r;
+			coeffs[2] = -p / 2.0;
+			coeffs[3] = 1.0;
+			int cubicCount = solveCubic(coeffs, s);
+			double z = s[0];
+			for (int i = 1; i < cubicCount; i++) {
+				z = std::max(z, s[i]);
 			}
-			angleRing = angleRing + angleRing_delta;
+
+			double u = z * z - r;
+			double v = 2.0 * z - p;
+			if (isZero(u)) u = 0.0;
+			else if (u > 0.0) u = sqrt(u);
+			else return 0;
+			if (isZero(v)) v = 0.0;
+			else if (v > 0.0) v = sqrt(v);
+			else return 0;
+
+			coeffs[0] = z - u;
+			coeffs[1] = q < 0.0 ? -v : v;
+			coeffs[2] = 1.0;
+			count = solveQuadratic(coeffs, s);
+
+			coeffs[0] = z + u;
+			coeffs[1] = q < 0.0 ? v : -v;
+			coeffs[2] = 1.0;
+			count += solveQuadratic(coeffs, s + count);
+		}
+
+		for (int i = 0; i < count; i++) {
+			s[i] -= A / 4.0;
+		}
+		return count;
+	}
+
+	static double evaluate(const double c[5], double x) {
+		return (((c[4] * x + c[3]) * x + c[2]) * x + c[1]) * x + c[0];
+	}
+
+	// Ferrari loses digits near double roots, up to two Newton steps on the quartic win
+	// them back. A step that makes the residual worse (it would head for another root) is dropped
+	static double polishRoot(const double c[5], double x) {
+		double f = evaluate(c, x);
+		for (int i = 0; i < 2; i++) {
+			double df = ((4.0 * c[4] * x + 3.0 * c[3]) * x + 2.0 * c[2]) * x + c[1];
+			if (df == 0.0) break;
+			double next = x - f / df;
+			double fNext = evaluate(c, next);
+			if (std::abs(fNext) >= std::abs(f)) break;
+			x = next;
+			f = fNext;
 		}
-		glEnd();
-	};
+		return x;
+	}
 };
 
-#endif
\ No newline at end of file
+#endif
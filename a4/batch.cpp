@@ -0,0 +1,227 @@
+/*  =================== File Information =================
+	File Name: batch.cpp
+	Description:
+	Author:
+
+	Purpose: Headless driver for the ray tracer. Renders scene files straight
+	         to image files without opening a window or a GL context, so frames
+	         can be rendered in batch on machines without a GPU.
+	Usage:	a4-batch [options] scene.xml [scene2.xml ...]
+	        -w <width>       image width (default 512)
+	        -h <height>      image height (default 512)
+	        -d <depth>       reflection recursion depth (default 2)
+	        -t <threads>     render threads, 0 = one per core (default 0)
+	        -i               intersection only (white where something is hit)
+	        -a <samples>     adaptive antialiasing budget per pixel: 1 (off), 4, 16 or 64 (default 1)
+	        -s <samples>     shadow rays per spot light with a radius or area light: 1, 4, 16 or 64 (default 16)
+	        -p <file>        write a Chrome trace of all frames to file and print counter totals
+	                         (needs a build with make PROFILE=1)
+	        -n <samples>     rays per pixel for cameras with an aperture, 1 to 64 (default 16)
+	        -e               trace a pixel's lens rays together as packets (same image)
+	        -u               Russian roulette on weak reflection paths (faster deep mirrors, a little noise)
+	        -m               also write a samples per pixel heatmap, <image>_spp.ppm
+	        -o <prefix>      output path prefix (default "./")
+	        -l <file>        file with one scene path per line, added to the scenes
+	        -c <file>        camera path, one frame per line:
+	                         eyeX eyeY eyeZ lookX lookY lookZ [upX upY upZ [heightAngle]]
+	                         without -c every scene renders one frame with its own camera
+	===================================================== */
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "RayTracer.h"
+
+using namespace std;
+
+struct CameraFrame {
+	glm::vec3 eye;
+	glm::vec3 look;
+	glm::vec3 up;
+	float heightAngle;      // <= 0 keeps the scene's angle
+};
+
+static void printUsage(const char* program) {
+	printf("usage: %s [-w width] [-h height] [-d depth] [-t threads] [-i] [-a samples] [-s samples] [-n samples] [-e] [-u] [-p trace.json] [-m] [-o prefix] [-l scenelist] [-c camerapath] scene.xml ...\n", program);
+}
+
+// writes a binary PPM, the ray tracer buffer is bottom row first so rows are flipped here
+static bool writePPM(const string& fileName, const unsigned char* pixels, int width, int height) {
+	FILE* file = fopen(fileName.c_str(), "wb");
+	if (file == NULL) {
+		printf("Unable to open %s for writing\n", fileName.c_str());
+		return false;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	for (int y = height - 1; y >= 0; y--) {
+		fwrite(pixels + y * width * 3, 1, width * 3, file);
+	}
+	fclose(file);
+	return true;
+}
+
+// the heatmap of the last render, and how many samples the frame took on average
+static bool writeSampleHeatmap(RayTracer& rayTracer, const string& fileName, vector<unsigned char>& heatmap, int width, int height) {
+	RenderStats stats = rayTracer.getRenderStats();
+	printf("%lld of %d pixels antialiased, %.2f samples per pixel\n", stats.refinedPixels, width * height, (double)stats.primaryRays / (width * height));
+	rayTracer.sampleHeatmap(&heatmap[0]);
+	return writePPM(fileName, &heatmap[0], width, height);
+}
+
+// reads non-empty lines that don't start with '#'
+static vector<string> readLines(const char* fileName) {
+	vector<string> lines;
+	ifstream file(fileName);
+	if (!file.is_open()) {
+		printf("Unable to open %s\n", fileName);
+		return lines;
+	}
+	string line;
+	while (getline(file, line)) {
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == string::npos || line[start] == '#') continue;
+		lines.push_back(line.substr(start));
+	}
+	return lines;
+}
+
+static bool readCameraPath(const char* fileName, vector<CameraFrame>& frames) {
+	vector<string> lines = readLines(fileName);
+	for (size_t i = 0; i < lines.size(); i++) {
+		istringstream in(lines[i]);
+		CameraFrame frame;
+		frame.up = glm::vec3(0, 1, 0);
+		frame.heightAngle = -1.0f;
+		if (!(in >> frame.eye.x >> frame.eye.y >> frame.eye.z >> frame.look.x >> frame.look.y >> frame.look.z)) {
+			printf("Invalid camera path line %d: %s\n", (int)i + 1, lines[i].c_str());
+			return false;
+		}
+		glm::vec3 up;
+		if (in >> up.x >> up.y >> up.z) {
+			frame.up = up;
+			in >> frame.heightAngle;
+		}
+		frames.push_back(frame);
+	}
+	return !frames.empty();
+}
+
+// "data/scenes/earth.xml" -> "earth"
+static string baseName(const string& path) {
+	size_t slash = path.find_last_of("/\\");
+	string name = (slash == string::npos) ? path : path.substr(slash + 1);
+	size_t dot = name.find_last_of('.');
+	return (dot == string::npos) ? name : name.substr(0, dot);
+}
+
+int main(int argc, char **argv) {
+	int width = 512;
+	int height = 512;
+	int recurseDepth = 2;
+	int numThreads = 0;
+	bool isectOnly = false;
+	int maxSamples = 1;
+	int lightSamples = 16;
+	int lensSamples = 16;
+	bool lensPackets = false;
+	bool writeHeatmap = false;
+	bool russianRoulette = false;
+	const char* traceFile = NULL;
+	string prefix = "./";
+	vector<string> scenes;
+	vector<CameraFrame> frames;
+
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "-w") && hasValue) width = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-h") && hasValue) height = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-d") && hasValue) recurseDepth = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-t") && hasValue) numThreads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-i")) isectOnly = true;
+		else if (!strcmp(argv[i], "-a") && hasValue) maxSamples = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-s") && hasValue) lightSamples = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-n") && hasValue) lensSamples = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-e")) lensPackets = true;
+		else if (!strcmp(argv[i], "-u")) russianRoulette = true;
+		else if (!strcmp(argv[i], "-m")) writeHeatmap = true;
+		else if (!strcmp(argv[i], "-p") && hasValue) traceFile = argv[++i];
+		else if (!strcmp(argv[i], "-o") && hasValue) prefix = argv[++i];
+		else if (!strcmp(argv[i], "-l") && hasValue) {
+			vector<string> listed = readLines(argv[++i]);
+			scenes.insert(scenes.end(), listed.begin(), listed.end());
+		}
+		else if (!strcmp(argv[i], "-c") && hasValue) {
+			if (!readCameraPath(argv[++i], frames)) return 1;
+		}
+		else if (argv[i][0] == '-') {
+			printUsage(argv[0]);
+			return 1;
+		}
+		else scenes.push_back(argv[i]);
+	}
+
+	if (scenes.empty() || width <= 0 || height <= 0) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	if (traceFile != NULL && !Profiler::enabled()) {
+		printf("a4-batch was built without profiling, -p is ignored (build with make PROFILE=1)\n");
+		traceFile = NULL;
+	}
+	Profiler::reset();
+
+	RayTracer rayTracer;
+	rayTracer.setNumThreads(numThreads);
+	rayTracer.setMaxSamples(maxSamples);
+	rayTracer.setLightSamples(lightSamples);
+	rayTracer.setRussianRoulette(russianRoulette);
+	rayTracer.setLensSamples(lensSamples);
+	rayTracer.setLensPackets(lensPackets);
+	Camera camera;
+	vector<unsigned char> pixels(width * height * 3);
+	vector<unsigned char> heatmap(writeHeatmap ? width * height * 3 : 0);
+	int failures = 0;
+
+	for (size_t s = 0; s < scenes.size(); s++) {
+		if (!rayTracer.loadSceneFile(scenes[s].c_str())) {
+			printf("Skipping %s\n", scenes[s].c_str());
+			failures++;
+			continue;
+		}
+		rayTracer.setupCamera(&camera);
+		string name = prefix + baseName(scenes[s]);
+
+		if (frames.empty()) {
+			rayTracer.render(&camera, &pixels[0], width, height, recurseDepth, isectOnly);
+			if (!writePPM(name + ".ppm", &pixels[0], width, height)) failures++;
+			if (writeHeatmap && !writeSampleHeatmap(rayTracer, name + "_spp.ppm", heatmap, width, height)) failures++;
+			continue;
+		}
+
+		float sceneAngle = camera.getViewAngle();
+		for (size_t f = 0; f < frames.size(); f++) {
+			camera.setViewAngle(frames[f].heightAngle > 0 ? frames[f].heightAngle : sceneAngle);
+			camera.orientLookVec(frames[f].eye, frames[f].look, frames[f].up);
+			rayTracer.render(&camera, &pixels[0], width, height, recurseDepth, isectOnly);
+
+			char frameName[32];
+			snprintf(frameName, sizeof(frameName), "_%04d.ppm", (int)f);
+			if (!writePPM(name + frameName, &pixels[0], width, height)) failures++;
+			snprintf(frameName, sizeof(frameName), "_%04d_spp.ppm", (int)f);
+			if (writeHeatmap && !writeSampleHeatmap(rayTracer, name + frameName, heatmap, width, height)) failures++;
+		}
+	}
+
+	if (traceFile != NULL) {
+		Profiler::printSummary(stdout);
+		if (!Profiler::writeChromeTrace(traceFile)) failures++;
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,419 @@
+/*  =================== File Information =================
+	File Name: benchmark.cpp
+	Description:
+	Author:
+
+	Purpose: Reproducible performance numbers for the ray tracer. Writes a fixed set
+	         of procedurally generated scenes (flat ones of growing size and ones
+	         built from nested master objects), renders each headless and prints
+	         a JSON report with rays/s, the time of every phase and peak memory.
+	         Every scene also gets one transform edited after its render, to
+	         time the incremental update against the full flatten.
+	         The scenes only depend on the built in seed, so reports from two
+	         commits can be compared directly, and with -b a previous report
+	         becomes the baseline that rays/s must not drop below.
+	Usage:	a4-bench [options]
+	        -w <width>       image width (default 256)
+	        -h <height>      image height (default 256)
+	        -d <depth>       reflection recursion depth (default 2)
+	        -t <threads>     render threads, 0 = one per core (default 0)
+	        -s <dir>         where the generated scenes are written (default ".")
+	        -o <file>        JSON report (default benchmark.json, stdout carries the parser's log)
+	        -b <file>        baseline report to compare against
+	        -r <fraction>    allowed rays/s drop against the baseline (default 0.2)
+	        -u               Russian roulette on weak reflection paths
+	        -e               trace the lens rays of the depth of field scene as packets
+	===================================================== */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "RayTracer.h"
+
+using namespace std;
+
+struct BenchScene {
+	const char* name;
+	int primitives;     // primitives in the innermost group
+	int branching;      // copies of the group below on every level
+	int nesting;        // levels of master objects, 1 = everything in one group
+	int extraLights;    // attenuated point, spot and area lights on top of the two base lights
+	int depth;          // reflection depth, 0 = the one given with -d
+	float mirror;       // reflectance of every material, 0 = random materials
+	float aperture;     // lens diameter of the camera, 0 = pinhole
+};
+
+// sizes grow by 8x, nested scenes grow through instancing instead of more primitives
+static const BenchScene SCENES[] = {
+	{ "flat_64", 64, 1, 1, 0, 0, 0.0f, 0.0f },
+	{ "flat_512", 512, 1, 1, 0, 0, 0.0f, 0.0f },
+	{ "flat_4096", 4096, 1, 1, 0, 0, 0.0f, 0.0f },
+	{ "nested_d2", 16, 4, 2, 0, 0, 0.0f, 0.0f },
+	{ "nested_d4", 16, 4, 4, 0, 0, 0.0f, 0.0f },
+	{ "nested_d6", 16, 4, 6, 0, 0, 0.0f, 0.0f },
+	{ "lights_32", 64, 1, 1, 32, 0, 0.0f, 0.0f },
+	// the same room of mirrors at growing depths, deep paths should end long before the limit
+	{ "mirrors_d4", 64, 1, 1, 0, 4, 0.95f, 0.0f },
+	{ "mirrors_d16", 64, 1, 1, 0, 16, 0.95f, 0.0f },
+	{ "mirrors_d64", 64, 1, 1, 0, 64, 0.95f, 0.0f },
+	// 16 lens rays per pixel focused on the middle of flat_512, run once with -e to compare packets
+	{ "dof_512", 512, 1, 1, 0, 0, 0.0f, 0.3f },
+};
+static const int NUM_SCENES = sizeof(SCENES) / sizeof(SCENES[0]);
+
+// small LCG so the scenes are identical on every platform
+static unsigned int randomState;
+static float random01() {
+	randomState = randomState * 1664525u + 1013904223u;
+	return (randomState >> 8) / 16777216.0f;
+}
+static float randomRange(float low, float high) {
+	return low + (high - low) * random01();
+}
+
+static void writeMaterial(ostream& out, float mirror) {
+	out << "<diffuse r=\"" << random01() << "\" g=\"" << random01() << "\" b=\"" << random01() << "\"/>\n";
+	out << "<ambient r=\"0.2\" g=\"0.1\" b=\"0.1\"/>\n";
+	out << "<specular r=\"1\" g=\"1\" b=\"1\"/>\n";
+	float r = random01(), g = random01(), b = random01();
+	if (mirror > 0.0f) {
+		r = g = b = mirror;
+	}
+	out << "<reflective r=\"" << r << "\" g=\"" << g << "\" b=\"" << b << "\"/>\n";
+	out << "<shininess v=\"20\"/>\n";
+}
+
+static void writeTransform(ostream& out, float spread, float size) {
+	out << "<translate x=\"" << randomRange(-spread, spread) << "\" y=\"" << randomRange(-spread, spread) << "\" z=\"" << randomRange(-spread, spread) << "\"/>";
+	out << "<rotate x=\"" << random01() << "\" y=\"1\" z=\"" << random01() << "\" angle=\"" << randomRange(0.0f, 180.0f) << "\"/>";
+	out << "<scale x=\"" << size * randomRange(0.5f, 1.0f) << "\" y=\"" << size * randomRange(0.5f, 1.0f) << "\" z=\"" << size * randomRange(0.5f, 1.0f) << "\"/>\n";
+}
+
+/* Level 0 holds the primitives spread over [-1.5, 1.5]^3, every level above places
+   branching scaled down copies of the one below in the same box, so the world
+   bounds stay the same however deep the nesting goes. */
+static bool writeScene(const string& fileName, const BenchScene& scene) {
+	ofstream out(fileName.c_str());
+	if (!out.is_open()) {
+		printf("Unable to write %s\n", fileName.c_str());
+		return false;
+	}
+	randomState = 175u;
+	static const char* shapes[] = { "cube", "cylinder", "cone", "sphere" };
+
+	out << "<scenefile>\n";
+	// the specular coefficient doubles as the reflection weight
+	out << "<globaldata><diffusecoeff v=\"0.6\"/><specularcoeff v=\"" << (scene.mirror > 0.0f ? 0.9f : 0.4f) << "\"/><ambientcoeff v=\"0.3\"/></globaldata>\n";
+	out << "<cameradata><pos x=\"0\" y=\"2\" z=\"6\"/><focus x=\"0\" y=\"0\" z=\"0\"/><up x=\"0\" y=\"1\" z=\"0\"/><heightangle v=\"45\"/>";
+	if (scene.aperture > 0.0f) {
+		out << "<aperture v=\"" << scene.aperture << "\"/>";
+	}
+	out << "</cameradata>\n";
+	out << "<lightdata><id v=\"0\"/><type v=\"point\"/><position x=\"3\" y=\"5\" z=\"3\"/><color r=\"1\" g=\"1\" b=\"1\"/></lightdata>\n";
+	out << "<lightdata><id v=\"1\"/><type v=\"directional\"/><direction x=\"-1\" y=\"-1\" z=\"0.5\"/><color r=\"0.4\" g=\"0.4\" b=\"0.5\"/></lightdata>\n";
+
+	// a ring of small lights that fade with distance, most of them only matter close by
+	static const char* lightTypes[] = { "point", "spot", "area" };
+	for (int i = 0; i < scene.extraLights; i++) {
+		float angle = 2.0f * PI * i / scene.extraLights;
+		const char* type = lightTypes[i % 3];
+		out << "<lightdata><id v=\"" << i + 2 << "\"/><type v=\"" << type << "\"/>";
+		out << "<position x=\"" << 2.5f * cos(angle) << "\" y=\"" << randomRange(0.0f, 2.0f) << "\" z=\"" << 2.5f * sin(angle) << "\"/>";
+		out << "<function x=\"1\" y=\"0\" z=\"25\"/>";
+		out << "<color r=\"" << random01() << "\" g=\"" << random01() << "\" b=\"" << random01() << "\"/>";
+		if (i % 3 == 1) {
+			out << "<direction x=\"" << -cos(angle) << "\" y=\"-1\" z=\"" << -sin(angle) << "\"/><radius v=\"0.1\"/><angle v=\"30\"/><penumbra v=\"10\"/>";
+		}
+		else if (i % 3 == 2) {
+			out << "<direction x=\"0\" y=\"-1\" z=\"0\"/><width v=\"0.3\"/><height v=\"0.3\"/>";
+		}
+		out << "</lightdata>\n";
+	}
+
+	// primitives shrink as there are more of them so the density stays about the same
+	float size = 1.2f / cbrt((float)scene.primitives);
+	out << "<object type=\"tree\" name=\"level0\">\n";
+	for (int i = 0; i < scene.primitives; i++) {
+		out << "<transblock>";
+		writeTransform(out, 1.5f, size);
+		out << "<object type=\"primitive\" name=\"" << shapes[i % 4] << "\">\n";
+		writeMaterial(out, scene.mirror);
+		out << "</object></transblock>\n";
+	}
+	out << "</object>\n";
+
+	for (int level = 1; level < scene.nesting; level++) {
+		out << "<object type=\"tree\" name=\"level" << level << "\">\n";
+		for (int i = 0; i < scene.branching; i++) {
+			out << "<transblock>";
+			writeTransform(out, 0.75f, 0.6f);
+			out << "<object type=\"master\" name=\"level" << level - 1 << "\"/></transblock>\n";
+		}
+		out << "</object>\n";
+	}
+
+	out << "<object type=\"tree\" name=\"root\">\n";
+	out << "<transblock><object type=\"master\" name=\"level" << scene.nesting - 1 << "\"/></transblock>\n";
+	out << "<transblock><translate x=\"0\" y=\"-2\" z=\"0\"/><scale x=\"8\" y=\"0.2\" z=\"8\"/><object type=\"primitive\" name=\"cube\">\n";
+	writeMaterial(out, scene.mirror);
+	out << "</object></transblock>\n";
+	// mirror scenes close the floor off into a room, so reflections bounce until the depth or their weight runs out
+	if (scene.mirror > 0.0f) {
+		static const float walls[5][6] = {
+			{ -8, 2, 0, 0.2f, 8, 16 }, { 8, 2, 0, 0.2f, 8, 16 },
+			{ 0, 2, -8, 16, 8, 0.2f }, { 0, 2, 8, 16, 8, 0.2f },
+			{ 0, 6, 0, 16, 0.2f, 16 },
+		};
+		for (int i = 0; i < 5; i++) {
+			out << "<transblock><translate x=\"" << walls[i][0] << "\" y=\"" << walls[i][1] << "\" z=\"" << walls[i][2] << "\"/>";
+			out << "<scale x=\"" << walls[i][3] << "\" y=\"" << walls[i][4] << "\" z=\"" << walls[i][5] << "\"/><object type=\"primitive\" name=\"cube\">\n";
+			writeMaterial(out, scene.mirror);
+			out << "</object></transblock>\n";
+		}
+	}
+	out << "</object>\n";
+	out << "</scenefile>\n";
+	return true;
+}
+
+// peak resident memory of the process so far in bytes
+static long long peakMemoryBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return (long long)counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return (long long)usage.ru_maxrss;          // bytes on macOS
+#else
+	return (long long)usage.ru_maxrss * 1024;   // kilobytes on Linux
+#endif
+#endif
+}
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+struct BenchResult {
+	string name;
+	int objects;
+	int nesting;
+	int depth;
+	double parseSeconds, flattenSeconds, traceSeconds, shadeSeconds, renderSeconds;
+	double editSeconds;     // prepareScene() after moving one node, 0 if there was none to move
+	RenderStats stats;
+	double raysPerSecond;
+	long long peakMemory;
+};
+
+// the first node in depth first order with a translation, NULL if there is none
+static SceneNode* findMovableNode(SceneNode* node, SceneTransformation*& translation) {
+	for (size_t i = 0; i < node->transformations.size(); i++) {
+		if (node->transformations[i]->type == TRANSFORMATION_TRANSLATE) {
+			translation = node->transformations[i];
+			return node;
+		}
+	}
+	for (size_t i = 0; i < node->children.size(); i++) {
+		SceneNode* found = findMovableNode(node->children[i], translation);
+		if (found != NULL) return found;
+	}
+	return NULL;
+}
+
+static bool runScene(RayTracer& rayTracer, const string& fileName, const BenchScene& scene, int width, int height, int recurseDepth, BenchResult& result) {
+	vector<unsigned char> pixels(width * height * 3);
+	Camera camera;
+
+	auto start = chrono::steady_clock::now();
+	if (!rayTracer.loadSceneFile(fileName.c_str())) return false;
+	result.parseSeconds = secondsSince(start);
+	rayTracer.setupCamera(&camera);
+
+	start = chrono::steady_clock::now();
+	rayTracer.prepareScene();
+	result.flattenSeconds = secondsSince(start);
+
+	start = chrono::steady_clock::now();
+	int depth = scene.depth > 0 ? scene.depth : recurseDepth;
+	rayTracer.renderPass(&camera, &pixels[0], width, height, depth, false, 1, false, NULL);
+	result.renderSeconds = secondsSince(start);
+
+	// moves one object (or, below a master, one object in every instance) a little
+	result.editSeconds = 0.0;
+	SceneTransformation* translation = NULL;
+	SceneNode* node = findMovableNode(rayTracer.parser->getRootNode(), translation);
+	if (node != NULL) {
+		translation->translate.x += 0.01f;
+		rayTracer.nodeChanged(node);
+		start = chrono::steady_clock::now();
+		rayTracer.prepareScene();
+		result.editSeconds = secondsSince(start);
+	}
+
+	result.name = scene.name;
+	result.objects = (int)rayTracer.sceneObjects.size();
+	result.nesting = scene.nesting;
+	result.depth = depth;
+	result.stats = rayTracer.getRenderStats();
+	// the phase times are summed over the threads, scale them to share the wall clock time
+	double threadSeconds = result.stats.traceSeconds + result.stats.shadeSeconds;
+	double scale = threadSeconds > 0 ? result.renderSeconds / threadSeconds : 0.0;
+	result.traceSeconds = result.stats.traceSeconds * scale;
+	result.shadeSeconds = result.stats.shadeSeconds * scale;
+	long long rays = result.stats.primaryRays + result.stats.shadowRays + result.stats.reflectionRays;
+	result.raysPerSecond = result.renderSeconds > 0 ? rays / result.renderSeconds : 0.0;
+	result.peakMemory = peakMemoryBytes();
+	return true;
+}
+
+static void writeReport(ostream& out, const vector<BenchResult>& results, int width, int height, int recurseDepth, int threads) {
+	out << "{\n";
+	out << "  \"width\": " << width << ",\n";
+	out << "  \"height\": " << height << ",\n";
+	out << "  \"depth\": " << recurseDepth << ",\n";
+	out << "  \"threads\": " << threads << ",\n";
+	out << "  \"scenes\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult& r = results[i];
+		out << "    {\n";
+		out << "      \"name\": \"" << r.name << "\",\n";
+		out << "      \"objects\": " << r.objects << ",\n";
+		out << "      \"nesting\": " << r.nesting << ",\n";
+		out << "      \"depth\": " << r.depth << ",\n";
+		out << "      \"parse_ms\": " << r.parseSeconds * 1000.0 << ",\n";
+		out << "      \"flatten_ms\": " << r.flattenSeconds * 1000.0 << ",\n";
+		out << "      \"trace_ms\": " << r.traceSeconds * 1000.0 << ",\n";
+		out << "      \"shade_ms\": " << r.shadeSeconds * 1000.0 << ",\n";
+		out << "      \"render_ms\": " << r.renderSeconds * 1000.0 << ",\n";
+		out << "      \"edit_ms\": " << r.editSeconds * 1000.0 << ",\n";
+		out << "      \"updated_objects\": " << r.stats.updatedObjects << ",\n";
+		out << "      \"primary_rays\": " << r.stats.primaryRays << ",\n";
+		out << "      \"shadow_rays\": " << r.stats.shadowRays << ",\n";
+		out << "      \"reflection_rays\": " << r.stats.reflectionRays << ",\n";
+		out << "      \"culled_lights\": " << r.stats.culledLights << ",\n";
+		out << "      \"rays_per_s\": " << (long long)r.raysPerSecond << ",\n";
+		out << "      \"peak_memory_bytes\": " << r.peakMemory << "\n";
+		out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+// pulls "name" / "rays_per_s" pairs out of a report written by writeReport
+static bool readBaseline(const char* fileName, vector<pair<string, double> >& baseline) {
+	ifstream in(fileName);
+	if (!in.is_open()) {
+		printf("Unable to open baseline %s\n", fileName);
+		return false;
+	}
+	string line, name;
+	while (getline(in, line)) {
+		size_t key = line.find("\"name\": \"");
+		if (key != string::npos) {
+			size_t start = key + 9;
+			name = line.substr(start, line.find('"', start) - start);
+		}
+		key = line.find("\"rays_per_s\": ");
+		if (key != string::npos && !name.empty()) {
+			baseline.push_back(make_pair(name, atof(line.c_str() + key + 14)));
+		}
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	int width = 256;
+	int height = 256;
+	int recurseDepth = 2;
+	int numThreads = 0;
+	string sceneDir = ".";
+	const char* reportFile = "benchmark.json";
+	const char* baselineFile = NULL;
+	double allowedDrop = 0.2;
+	bool russianRoulette = false;
+	bool lensPackets = false;
+
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "-w") && hasValue) width = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-h") && hasValue) height = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-d") && hasValue) recurseDepth = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-t") && hasValue) numThreads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-s") && hasValue) sceneDir = argv[++i];
+		else if (!strcmp(argv[i], "-o") && hasValue) reportFile = argv[++i];
+		else if (!strcmp(argv[i], "-b") && hasValue) baselineFile = argv[++i];
+		else if (!strcmp(argv[i], "-r") && hasValue) allowedDrop = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-u")) russianRoulette = true;
+		else if (!strcmp(argv[i], "-e")) lensPackets = true;
+		else {
+			printf("usage: %s [-w width] [-h height] [-d depth] [-t threads] [-s scenedir] [-o report.json] [-b baseline.json] [-r fraction] [-u] [-e]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	vector<BenchResult> results;
+	for (int s = 0; s < NUM_SCENES; s++) {
+		string fileName = sceneDir + "/bench_" + SCENES[s].name + ".xml";
+		if (!writeScene(fileName, SCENES[s])) return 1;
+
+		// a fresh ray tracer per scene so one scene's caches don't help the next
+		RayTracer rayTracer;
+		rayTracer.setNumThreads(numThreads);
+		rayTracer.setRussianRoulette(russianRoulette);
+		rayTracer.setLensPackets(lensPackets);
+		BenchResult result;
+		if (!runScene(rayTracer, fileName, SCENES[s], width, height, recurseDepth, result)) {
+			printf("Failed to render %s\n", fileName.c_str());
+			return 1;
+		}
+		results.push_back(result);
+	}
+
+	int threads = numThreads > 0 ? numThreads : ThreadPool::defaultThreadCount();
+	ofstream out(reportFile);
+	if (!out.is_open()) {
+		printf("Unable to write %s\n", reportFile);
+		return 1;
+	}
+	writeReport(out, results, width, height, recurseDepth, threads);
+	out.close();
+
+	printf("\n%-12s %8s %10s %10s %10s %10s %10s %12s\n", "scene", "objects", "parse ms", "flatten ms", "edit ms", "trace ms", "shade ms", "rays/s");
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult& r = results[i];
+		printf("%-12s %8d %10.1f %10.1f %10.2f %10.1f %10.1f %12.0f\n", r.name.c_str(), r.objects, r.parseSeconds * 1000.0, r.flattenSeconds * 1000.0, r.editSeconds * 1000.0, r.traceSeconds * 1000.0, r.shadeSeconds * 1000.0, r.raysPerSecond);
+	}
+	printf("report written to %s\n", reportFile);
+
+	if (baselineFile == NULL) return 0;
+	vector<pair<string, double> > baseline;
+	if (!readBaseline(baselineFile, baseline)) return 1;
+	int regressions = 0;
+	for (size_t i = 0; i < results.size(); i++) {
+		for (size_t j = 0; j < baseline.size(); j++) {
+			if (baseline[j].first != results[i].name) continue;
+			double ratio = baseline[j].second > 0 ? results[i].raysPerSecond / baseline[j].second : 1.0;
+			if (ratio < 1.0 - allowedDrop) {
+				fprintf(stderr, "REGRESSION %s: %.0f rays/s, baseline %.0f (%.0f%%)\n", results[i].name.c_str(), results[i].raysPerSecond, baseline[j].second, ratio * 100.0);
+				regressions++;
+			}
+		}
+	}
+	return regressions == 0 ? 0 : 2;
+}
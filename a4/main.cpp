@@ -35,12 +35,18 @@ MyAppWindow *win;
 class MyAppWindow : public Fl_Window {
 public:
 	Fl_Button* isectButton;
+	Fl_Button* progressiveButton;
+	Fl_Button* heatmapButton;
 	Fl_Button* renderButton;
 	Fl_Button* openFileButton;
 	Fl_Slider* segmentsXSlider;
 	Fl_Slider* segmentsYSlider;
 
 	Fl_Slider* recurseDepthSlider;
+	Fl_Slider* threadsSlider;
+	Fl_Slider* samplesSlider;
+	Fl_Slider* lightSamplesSlider;
+	Fl_Slider* lensSamplesSlider;
 
 	Fl_Slider* rotUSlider;
 	Fl_Slider* rotVSlider;
@@ -74,6 +80,7 @@ public:
 private:
 	void updateGUIValues() {
 		isectButton->value(canvas->isectOnly);
+		progressiveButton->value(canvas->progressive);
 		
 		segmentsXSlider->value(canvas->segmentsX);
 		segmentsYSlider->value(canvas->segmentsY);
@@ -95,6 +102,11 @@ private:
 		angleSlider->value(canvas->camera->viewAngle);
 
 		recurseDepthSlider->value(canvas->recurseDepth);
+		threadsSlider->value(canvas->numThreads);
+		samplesSlider->value(canvas->maxSamples);
+		lightSamplesSlider->value(canvas->lightSamples);
+		lensSamplesSlider->value(canvas->lensSamples);
+		heatmapButton->value(canvas->showHeatmap);
 	}
 
 	// Someone changed one of the sliders
@@ -102,6 +114,7 @@ private:
 		int value = ((Fl_Button*)w)->value();
 		printf("value: %d\n", value);
 		*((int*)userdata) = value;
+		win->canvas->restartRender();
 	}
 
 	static void segmentsCB(Fl_Widget* w, void* userdata) {
@@ -111,6 +124,43 @@ private:
 		win->canvas->setSegments();
 	}
 
+	static void recurseDepthCB(Fl_Widget* w, void* userdata) {
+		int value = ((Fl_Slider*)w)->value();
+		printf("recurse depth: %d\n", value);
+		win->canvas->recurseDepth = value;
+		win->canvas->restartRender();
+	}
+
+	static void threadsCB(Fl_Widget* w, void* userdata) {
+		int value = ((Fl_Slider*)w)->value();
+		printf("threads: %d\n", value);
+		win->canvas->setNumThreads(value);
+	}
+
+	static void samplesCB(Fl_Widget* w, void* userdata) {
+		int value = ((Fl_Slider*)w)->value();
+		win->canvas->setMaxSamples(value);
+		printf("antialiasing samples: %d\n", win->canvas->maxSamples);
+	}
+
+	static void lightSamplesCB(Fl_Widget* w, void* userdata) {
+		int value = ((Fl_Slider*)w)->value();
+		win->canvas->setLightSamples(value);
+		printf("light samples: %d\n", win->canvas->lightSamples);
+	}
+
+	static void lensSamplesCB(Fl_Widget* w, void* userdata) {
+		int value = ((Fl_Slider*)w)->value();
+		win->canvas->setLensSamples(value);
+		printf("lens samples: %d\n", win->canvas->lensSamples);
+	}
+
+	// only changes what is drawn, the frame doesn't need tracing again
+	static void heatmapCB(Fl_Widget* w, void* userdata) {
+		win->canvas->showHeatmap = ((Fl_Button*)w)->value();
+		win->canvas->redraw();
+	}
+
 	static void sliderFloatCB(Fl_Widget* w, void* userdata) {
 		float value = ((Fl_Slider*)w)->value();
 		printf("value: %f\n", value);
@@ -147,6 +197,7 @@ private:
 
 	static void cameraRotateCB(Fl_Widget* w, void* userdata) {
 		win->canvas->camera->setRotUVW(win->rotUSlider->value(), win->rotVSlider->value(), win->rotWSlider->value());
+		win->canvas->restartRender();
 	}
 
 	static void cameraEyeCB(Fl_Widget* w, void* userdata) {
@@ -154,6 +205,7 @@ private:
 		float eyeY = win->eyeYSlider->value();
 		float eyeZ = win->eyeZSlider->value();
 		win->canvas->camera->orientLookVec(glm::vec3(eyeX, eyeY, eyeZ), win->canvas->camera->getLookVector(), win->canvas->camera->getUpVector());
+		win->canvas->restartRender();
 	}	
 
 	static void cameraLookCB(Fl_Widget* w, void* userdata) {
@@ -161,6 +213,7 @@ private:
 		float lookY = win->lookYSlider->value();
 		float lookZ = win->lookZSlider->value();
 		win->canvas->camera->orientLookVec(win->canvas->camera->getEyePoint(), glm::vec3(lookX, lookY, lookZ), win->canvas->camera->getUpVector());
+		win->canvas->restartRender();
 	}	
 
 	static void camPropCB(Fl_Widget* w, void* userdata) {
@@ -171,6 +224,7 @@ private:
 		win->canvas->camera->setNearPlane(nearVal);
 		win->canvas->camera->setFarPlane(farVal);
 		win->canvas->camera->setViewAngle(angle);
+		win->canvas->restartRender();
 	}
 };
 
@@ -215,6 +269,54 @@ MyAppWindow::MyAppWindow(int W, int H, const char*L) : Fl_Window(W, H, L) {
 		isectButton->value(canvas->isectOnly);
 		isectButton->callback(toggleCB, (void*)(&(canvas->isectOnly)));
 
+		progressiveButton = new Fl_Check_Button(0, 0, pack->w() - 20, 20, "progressive");
+		progressiveButton->value(canvas->progressive);
+		progressiveButton->callback(toggleCB, (void*)(&(canvas->progressive)));
+
+		//slider for the size of the render thread pool, 0 uses every core
+		Fl_Box* threadsTextbox = new Fl_Box(0, 0, pack->w() - 20, 20, "Threads (0 = all)");
+		threadsSlider = new Fl_Value_Slider(0, 0, pack->w() - 20, 20, "");
+		threadsSlider->align(FL_ALIGN_TOP);
+		threadsSlider->type(FL_HOR_SLIDER);
+		threadsSlider->bounds(0, 64);
+		threadsSlider->step(1);
+		threadsSlider->value(canvas->numThreads);
+		threadsSlider->callback(threadsCB);
+
+		//slider for the antialiasing budget, rounded down to 1, 4, 16 or 64 samples per pixel
+		Fl_Box* samplesTextbox = new Fl_Box(0, 0, pack->w() - 20, 20, "AA samples");
+		samplesSlider = new Fl_Value_Slider(0, 0, pack->w() - 20, 20, "");
+		samplesSlider->align(FL_ALIGN_TOP);
+		samplesSlider->type(FL_HOR_SLIDER);
+		samplesSlider->bounds(1, 64);
+		samplesSlider->step(1);
+		samplesSlider->value(canvas->maxSamples);
+		samplesSlider->callback(samplesCB);
+
+		//slider for the shadow rays of area and spot lights, rounded down like the AA samples
+		Fl_Box* lightSamplesTextbox = new Fl_Box(0, 0, pack->w() - 20, 20, "Light samples");
+		lightSamplesSlider = new Fl_Value_Slider(0, 0, pack->w() - 20, 20, "");
+		lightSamplesSlider->align(FL_ALIGN_TOP);
+		lightSamplesSlider->type(FL_HOR_SLIDER);
+		lightSamplesSlider->bounds(1, 64);
+		lightSamplesSlider->step(1);
+		lightSamplesSlider->value(canvas->lightSamples);
+		lightSamplesSlider->callback(lightSamplesCB);
+
+		//slider for the rays per pixel of a camera with an aperture, no effect on a pinhole camera
+		Fl_Box* lensSamplesTextbox = new Fl_Box(0, 0, pack->w() - 20, 20, "Lens samples");
+		lensSamplesSlider = new Fl_Value_Slider(0, 0, pack->w() - 20, 20, "");
+		lensSamplesSlider->align(FL_ALIGN_TOP);
+		lensSamplesSlider->type(FL_HOR_SLIDER);
+		lensSamplesSlider->bounds(1, 64);
+		lensSamplesSlider->step(1);
+		lensSamplesSlider->value(canvas->lensSamples);
+		lensSamplesSlider->callback(lensSamplesCB);
+
+		heatmapButton = new Fl_Check_Button(0, 0, pack->w() - 20, 20, "spp heatmap");
+		heatmapButton->value(canvas->showHeatmap);
+		heatmapButton->callback(heatmapCB);
+
 	buttonsPack->end();
 
 	Fl_Pack* radioPack = new Fl_Pack(w() - 100, 30, 100, h(), "Shape");
@@ -232,7 +334,7 @@ MyAppWindow::MyAppWindow(int W, int H, const char*L) : Fl_Window(W, H, L) {
 		recurseDepthSlider->bounds(0, 5);
 		recurseDepthSlider->step(1);
 		recurseDepthSlider->value(canvas->recurseDepth);
-		recurseDepthSlider->callback(segmentsCB, (void*)(&(canvas->recurseDepth)));
+		recurseDepthSlider->callback(recurseDepthCB);
 
 
 		//slider for controlling number of segments in X
@@ -412,6 +514,8 @@ MyAppWindow::MyAppWindow(int W, int H, const char*L) : Fl_Window(W, H, L) {
 
 /**************************************** main() ********************/
 int main(int argc, char **argv) {
+	// lets the progressive render thread wake the UI with Fl::awake()
+	Fl::lock();
 	win = new MyAppWindow(850, 475, "Scene");
 	win->resizable(win);
 	Fl::add_idle(MyAppWindow::idleCB);
@@ -0,0 +1,183 @@
+/*  =================== File Information =================
+	File Name: packetbench.cpp
+	Description:
+	Author:
+
+	Purpose: Micro-benchmark for the ray intersection kernels. Times the scalar
+	         intersect() of every analytic shape against its packet version at
+	         4, 8 and 16 rays per call and prints the throughput in Mrays/s.
+	         Also counts lanes where the packet t differs from the scalar one,
+	         which should always be 0. The torus is also timed against sphere
+	         tracing its distance field, the iterative method the analytic
+	         quartic replaces, and the two are checked for agreeing hits.
+	Usage:	a4-packetbench [rays per test (default 4000000)]
+	===================================================== */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Cube.h"
+#include "Cylinder.h"
+#include "Cone.h"
+#include "Sphere.h"
+#include "Torus.h"
+
+// normally defined by RayTracer.cpp, which the benchmark doesn't link
+int Shape::m_segmentsX;
+int Shape::m_segmentsY;
+
+using namespace std;
+
+// camera rays through a square grid in front of the object, about half of them hit it
+static vector<glm::vec3> makeRays(int count) {
+	vector<glm::vec3> rays(count);
+	int side = 256;
+	for (int i = 0; i < count; i++) {
+		int x = i % side;
+		int y = (i / side) % side;
+		float u = (x + 0.5f) / side - 0.5f;
+		float v = (y + 0.5f) / side - 0.5f;
+		rays[i] = glm::normalize(glm::vec3(u * 0.6f, v * 0.6f, -1.0f));
+	}
+	return rays;
+}
+
+static double seconds(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// returns the scalar throughput in Mrays/s
+template <typename ShapeType>
+static double benchScalar(ShapeType& shape, const glm::mat4& inverseMatrix, const glm::vec3& eye, const vector<glm::vec3>& rays, vector<float>& t) {
+	auto start = chrono::steady_clock::now();
+	for (size_t i = 0; i < rays.size(); i++) {
+		t[i] = shape.intersect(eye, rays[i], inverseMatrix);
+	}
+	double mrays = rays.size() / seconds(start) / 1e6;
+	printf("  scalar    %8.1f Mrays/s\n", mrays);
+	return mrays;
+}
+
+template <int N, typename ShapeType>
+static void benchPacket(ShapeType& shape, const glm::mat4& inverseMatrix, const glm::vec3& eye, const vector<glm::vec3>& rays, const vector<float>& scalarT, double scalarMrays) {
+	int numPackets = (int)rays.size() / N;
+	vector<RayPacket<N> > packets(numPackets);
+	for (int p = 0; p < numPackets; p++) {
+		for (int lane = 0; lane < N; lane++) {
+			packets[p].set(lane, eye, rays[p * N + lane]);
+		}
+	}
+	vector<float> t(numPackets * N);
+
+	auto start = chrono::steady_clock::now();
+	for (int p = 0; p < numPackets; p++) {
+		shape.intersectPacket(packets[p], inverseMatrix, &t[p * N]);
+	}
+	double mrays = numPackets * N / seconds(start) / 1e6;
+
+	int mismatches = 0;
+	for (int i = 0; i < numPackets * N; i++) {
+		if (memcmp(&t[i], &scalarT[i], sizeof(float)) != 0) mismatches++;
+	}
+	printf("  packet %2d %8.1f Mrays/s  (%.2fx, %d mismatches)\n", N, mrays, mrays / scalarMrays, mismatches);
+}
+
+template <typename ShapeType>
+static void benchShape(const char* name, ShapeType& shape, const vector<glm::vec3>& rays) {
+	glm::mat4 transform = glm::rotate(glm::mat4(1.0f), 0.4f, glm::vec3(0.3f, 1.0f, 0.2f));
+	transform = glm::scale(transform, glm::vec3(1.5f, 1.0f, 1.2f));
+	glm::mat4 inverseMatrix = glm::inverse(transform);
+	glm::vec3 eye(0.0f, 0.0f, 3.0f);
+
+	vector<float> scalarT(rays.size());
+	printf("%s\n", name);
+	double scalarMrays = benchScalar(shape, inverseMatrix, eye, rays, scalarT);
+	benchPacket<4>(shape, inverseMatrix, eye, rays, scalarT, scalarMrays);
+	benchPacket<8>(shape, inverseMatrix, eye, rays, scalarT, scalarMrays);
+	benchPacket<16>(shape, inverseMatrix, eye, rays, scalarT, scalarMrays);
+}
+
+// marches the torus distance field in object space, -1 on a miss
+static float sphereTraceTorus(const glm::vec3& eye, const glm::vec3& ray, const glm::mat4& inverseMatrix) {
+	glm::vec3 P = glm::vec3(inverseMatrix * glm::vec4(eye, 1.0f));
+	glm::vec3 d = glm::vec3(inverseMatrix * glm::vec4(ray, 0.0f));
+	float length = glm::length(d);
+	d /= length;
+	float s = 0.0f;
+	for (int i = 0; i < 512; i++) {
+		glm::vec3 p = P + s * d;
+		float ring = sqrt(p.x * p.x + p.y * p.y) - Torus::RING_RADIUS;
+		float distance = sqrt(ring * ring + p.z * p.z) - Torus::TUBE_RADIUS;
+		if (distance < 1e-5f) return s / length;
+		s += distance;
+		if (s > 10.0f) break;
+	}
+	return -1.0f;
+}
+
+static void benchTorusFallback(Torus& torus, const vector<glm::vec3>& rays) {
+	glm::mat4 transform = glm::rotate(glm::mat4(1.0f), 0.4f, glm::vec3(0.3f, 1.0f, 0.2f));
+	transform = glm::scale(transform, glm::vec3(1.5f, 1.0f, 1.2f));
+	glm::mat4 inverseMatrix = glm::inverse(transform);
+	glm::vec3 eye(0.0f, 0.0f, 3.0f);
+
+	vector<float> analyticT(rays.size());
+	vector<float> tracedT(rays.size());
+	auto start = chrono::steady_clock::now();
+	for (size_t i = 0; i < rays.size(); i++) {
+		analyticT[i] = torus.intersect(eye, rays[i], inverseMatrix);
+	}
+	double analyticMrays = rays.size() / seconds(start) / 1e6;
+	start = chrono::steady_clock::now();
+	for (size_t i = 0; i < rays.size(); i++) {
+		tracedT[i] = sphereTraceTorus(eye, rays[i], inverseMatrix);
+	}
+	double tracedMrays = rays.size() / seconds(start) / 1e6;
+
+	// grazing rays can slip past the marcher, so only count clear disagreements
+	int hits = 0, disagreements = 0;
+	float maxError = 0.0f;
+	for (size_t i = 0; i < rays.size(); i++) {
+		bool analyticHit = analyticT[i] > 0.0f;
+		if (analyticHit) hits++;
+		if (analyticHit != (tracedT[i] > 0.0f)) {
+			disagreements++;
+		}
+		else if (analyticHit) {
+			maxError = std::max(maxError, std::abs(analyticT[i] - tracedT[i]));
+		}
+	}
+	printf("torus, analytic vs sphere traced\n");
+	printf("  analytic  %8.1f Mrays/s\n", analyticMrays);
+	printf("  traced    %8.1f Mrays/s  (analytic %.2fx faster)\n", tracedMrays, analyticMrays / tracedMrays);
+	printf("  %d hits, %d rays hit by only one, max t difference %g\n", hits, disagreements, maxError);
+}
+
+int main(int argc, char **argv) {
+	int count = argc > 1 ? atoi(argv[1]) : 4000000;
+	// whole packets of every size
+	count = (count / 16) * 16;
+	if (count <= 0) {
+		printf("usage: %s [rays per test]\n", argv[0]);
+		return 1;
+	}
+	vector<glm::vec3> rays = makeRays(count);
+
+	Cube cube;
+	Cylinder cylinder;
+	Cone cone;
+	Sphere sphere;
+	Torus torus;
+	benchShape("cube", cube, rays);
+	benchShape("cylinder", cylinder, rays);
+	benchShape("cone", cone, rays);
+	benchShape("sphere", sphere, rays);
+	benchShape("torus", torus, rays);
+	benchTorusFallback(torus, rays);
+	return 0;
+}
@@ -0,0 +1,732 @@
+/*  =================== File Information =================
+File Name: ply.cpp
+Description: parses ASCII and binary PLY files for the ray tracer's triangle meshes
+Author: (You)
+
+Purpose:
+Examples:
+===================================================== */
+#define _CRT_SECURE_NO_WARNINGS
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <fstream>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "ply.h"
+#include "ThreadPool.h"
+#include <math.h>
+
+
+using namespace std;
+
+// bodies smaller than this aren't worth splitting up
+static const size_t MIN_CHUNK_BYTES = 1 << 18;
+
+// the scalar types of the PLY header, each under its old and its sized name
+enum PlyType { PLY_NONE, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+enum PlyFormat { PLY_ASCII, PLY_BINARY_LITTLE_ENDIAN, PLY_BINARY_BIG_ENDIAN };
+
+struct PlyProperty {
+	string name;
+	PlyType type;           // of the value, or of the entries of a list
+	PlyType countType;      // PLY_NONE unless the property is a list
+	int offset;             // bytes from the start of a binary record, -1 behind a list
+};
+
+// one element of the header, the lines (or binary records) of its records follow each other in the body
+struct PlyElement {
+	string name;
+	int count;
+	vector<PlyProperty> properties;
+	int listProperty;       // index of the first list property, -1 if there is none
+	int stride;             // bytes of a binary record, -1 if the record has a list
+};
+
+static PlyType typeFromName(const string& name) {
+	if (name == "char" || name == "int8") return PLY_INT8;
+	if (name == "uchar" || name == "uint8") return PLY_UINT8;
+	if (name == "short" || name == "int16") return PLY_INT16;
+	if (name == "ushort" || name == "uint16") return PLY_UINT16;
+	if (name == "int" || name == "int32") return PLY_INT32;
+	if (name == "uint" || name == "uint32") return PLY_UINT32;
+	if (name == "float" || name == "float32") return PLY_FLOAT32;
+	if (name == "double" || name == "float64") return PLY_FLOAT64;
+	return PLY_NONE;
+}
+
+static int typeSize(PlyType type) {
+	switch (type) {
+	case PLY_INT8: case PLY_UINT8: return 1;
+	case PLY_INT16: case PLY_UINT16: return 2;
+	case PLY_INT32: case PLY_UINT32: case PLY_FLOAT32: return 4;
+	case PLY_FLOAT64: return 8;
+	default: return 0;
+	}
+}
+
+// the binary format whose values can be used without swapping bytes
+static PlyFormat hostFormat() {
+	const unsigned short one = 1;
+	return *(const unsigned char*)&one == 1 ? PLY_BINARY_LITTLE_ENDIAN : PLY_BINARY_BIG_ENDIAN;
+}
+
+/*	The whole file, mapped read only where mmap exists and read into a new[] buffer
+	elsewhere. NULL if the file can't be read. */
+static char* loadFile(const string& fileName, size_t& size) {
+#ifdef _WIN32
+	ifstream file(fileName.c_str(), ios::in | ios::binary | ios::ate);
+	if (!file.is_open()) return NULL;
+	size = (size_t)file.tellg();
+	if (size == 0) return NULL;
+	char* data = new char[size];
+	file.seekg(0);
+	file.read(data, size);
+	return data;
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) return NULL;
+	char* data = NULL;
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size > 0) {
+		size = (size_t)info.st_size;
+		void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED) data = (char*)mapping;
+	}
+	close(fd);
+	return data;
+#endif
+}
+
+static void releaseFile(char* data, size_t size) {
+#ifdef _WIN32
+	delete[] data;
+#else
+	munmap(data, size);
+#endif
+}
+
+static inline const char* skipBlanks(const char* p, const char* end) {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+	return p;
+}
+
+// atoi without the locale, false (and p unmoved) if the line has no number left
+static inline bool parseInt(const char*& p, const char* end, int& value) {
+	const char* q = skipBlanks(p, end);
+	bool negative = q < end && *q == '-';
+	if (q < end && (*q == '-' || *q == '+')) q++;
+	unsigned int digit;
+	if (q >= end || (digit = (unsigned char)*q - '0') > 9) return false;
+	unsigned long long result = digit;
+	for (q++; q < end && (digit = (unsigned char)*q - '0') <= 9; q++) {
+		result = std::min(result * 10 + digit, 0x80000000ULL);
+	}
+	value = (int)std::min(result, 0x7fffffffULL) * (negative ? -1 : 1);
+	p = q;
+	return true;
+}
+
+/*	atof without the locale: the digits are gathered into an integer and scaled by an
+	exact power of ten. While both fit in a double this rounds only once, so the result
+	is the double strtod gives (Clinger's fast path). Longer mantissas, huge exponents,
+	inf and nan go through strtod. false if the line has no number left. */
+static inline bool parseFloat(const char*& p, const char* end, float& value) {
+	static const double POWERS[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const char* q = skipBlanks(p, end);
+	const char* token = q;
+	bool negative = q < end && *q == '-';
+	if (q < end && (*q == '-' || *q == '+')) q++;
+
+	// leading zeros add nothing, the digits after them have to fit in 19
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	const char* first = q;
+	unsigned int digit;
+	while (q < end && *q == '0') q++;
+	for (; q < end && (digit = (unsigned char)*q - '0') <= 9; q++, digits++) {
+		mantissa = mantissa * 10 + digit;
+	}
+	bool any = q > first;
+	if (q < end && *q == '.') {
+		const char* fraction = ++q;
+		if (digits == 0) {
+			while (q < end && *q == '0') q++;
+		}
+		for (; q < end && (digit = (unsigned char)*q - '0') <= 9; q++, digits++) {
+			mantissa = mantissa * 10 + digit;
+		}
+		exponent = -(int)(q - fraction);
+		any = any || q > fraction;
+	}
+	// an exponent only counts with digits right behind the e and its sign
+	if (any && q + 1 < end && (*q == 'e' || *q == 'E') && (q[1] == '-' || q[1] == '+' || (unsigned)((unsigned char)q[1] - '0') <= 9)) {
+		const char* e = q + 1;
+		int power;
+		if (parseInt(e, end, power)) {
+			exponent += std::max(-1000, std::min(power, 1000));
+			q = e;
+		}
+	}
+
+	if (any && digits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+		double result = (double)mantissa;
+		result = exponent < 0 ? result / POWERS[-exponent] : result * POWERS[exponent];
+		value = (float)(negative ? -result : result);
+		p = q;
+		return true;
+	}
+
+	// copied out because the mapped file has no terminating zero
+	char buffer[64];
+	size_t length = 0;
+	for (const char* c = token; c < end && length + 1 < sizeof(buffer) && *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n'; c++) {
+		buffer[length++] = *c;
+	}
+	buffer[length] = 0;
+	char* stop;
+	double result = strtod(buffer, &stop);
+	if (stop == buffer) return false;
+	value = (float)result;
+	p = token + (stop - buffer);
+	return true;
+}
+
+// the header up to end_header, false if it isn't a PLY file this loader understands. body is set to the first data byte
+static bool parseHeader(const char* data, size_t size, PlyFormat& format, vector<PlyElement>& elements, size_t& body) {
+	size_t pos = 0;
+	bool known = false;
+	bool first = true;
+	while (pos < size) {
+		const char* lineEnd = (const char*)memchr(data + pos, '\n', size - pos);
+		size_t next = lineEnd != NULL ? lineEnd - data + 1 : size;
+		istringstream line(string(data + pos, next - pos));
+		pos = next;
+
+		string keyword;
+		line >> keyword;
+		if (first) {
+			if (keyword != "ply") return false;
+			first = false;
+		}
+		else if (keyword == "format") {
+			string name;
+			line >> name;
+			known = true;
+			if (name == "ascii") format = PLY_ASCII;
+			else if (name == "binary_little_endian") format = PLY_BINARY_LITTLE_ENDIAN;
+			else if (name == "binary_big_endian") format = PLY_BINARY_BIG_ENDIAN;
+			else known = false;
+		}
+		else if (keyword == "element") {
+			PlyElement element;
+			element.count = 0;
+			element.listProperty = -1;
+			element.stride = 0;
+			line >> element.name >> element.count;
+			if (element.count < 0) return false;
+			elements.push_back(element);
+		}
+		else if (keyword == "property" && !elements.empty()) {
+			PlyElement& element = elements.back();
+			PlyProperty property;
+			string type;
+			line >> type;
+			property.countType = PLY_NONE;
+			if (type == "list") {
+				string countType;
+				line >> countType >> type;
+				property.countType = typeFromName(countType);
+				if (property.countType == PLY_NONE || property.countType == PLY_FLOAT32 || property.countType == PLY_FLOAT64) return false;
+				if (element.listProperty < 0) element.listProperty = (int)element.properties.size();
+			}
+			property.type = typeFromName(type);
+			if (property.type == PLY_NONE) return false;
+			line >> property.name;
+			property.offset = element.stride;
+			if (element.stride >= 0) {
+				element.stride = property.countType == PLY_NONE ? element.stride + typeSize(property.type) : -1;
+			}
+			element.properties.push_back(property);
+		}
+		else if (keyword == "end_header") {
+			body = pos;
+			return known;
+		}
+	}
+	return false;
+}
+
+// one binary value at p, byte swapped unless the file has the machine's byte order. false if the body ends first
+static inline bool readValue(const char*& p, const char* end, PlyType type, PlyFormat format, double& value) {
+	int size = typeSize(type);
+	if (size == 0 || end - p < size) return false;
+	unsigned char bytes[8];
+	memcpy(bytes, p, size);
+	p += size;
+	if (format != hostFormat()) {
+		std::reverse(bytes, bytes + size);
+	}
+	switch (type) {
+	case PLY_INT8: value = (signed char)bytes[0]; break;
+	case PLY_UINT8: value = bytes[0]; break;
+	case PLY_INT16: { short v; memcpy(&v, bytes, 2); value = v; break; }
+	case PLY_UINT16: { unsigned short v; memcpy(&v, bytes, 2); value = v; break; }
+	case PLY_INT32: { int v; memcpy(&v, bytes, 4); value = v; break; }
+	case PLY_UINT32: { unsigned int v; memcpy(&v, bytes, 4); value = v; break; }
+	case PLY_FLOAT32: { float v; memcpy(&v, bytes, 4); value = v; break; }
+	default: { double v; memcpy(&v, bytes, 8); value = v; break; }
+	}
+	return true;
+}
+
+// a binary scalar or list stepped over
+static bool skipProperty(const char*& p, const char* end, const PlyProperty& property, PlyFormat format) {
+	if (property.countType == PLY_NONE) {
+		int size = typeSize(property.type);
+		if (end - p < size) return false;
+		p += size;
+		return true;
+	}
+	double count;
+	if (!readValue(p, end, property.countType, format, count) || count < 0) return false;
+	double bytes = count * typeSize(property.type);
+	if (bytes > (double)(end - p)) return false;
+	p += (size_t)bytes;
+	return true;
+}
+
+/*	Reads a binary body front to back. There is nothing to parse, so it isn't split up.
+	x, y and z stored as consecutive floats and 32 bit face indices in the machine's
+	byte order are copied as they are, everything else goes value by value. */
+static bool readBinary(const char* p, const char* end, const vector<PlyElement>& elements, PlyFormat format,
+	int vertexElement, int faceElement, float* positions, vector<int>& faceStarts, vector<int>& faceIndices) {
+	for (size_t e = 0; e < elements.size(); e++) {
+		const PlyElement& element = elements[e];
+		const vector<PlyProperty>& properties = element.properties;
+		if ((int)e == vertexElement) {
+			vector<int> axes(properties.size(), -1);
+			int xProperty = -1;
+			for (size_t k = 0; k < properties.size(); k++) {
+				if (properties[k].name == "x") { axes[k] = 0; xProperty = (int)k; }
+				if (properties[k].name == "y") axes[k] = 1;
+				if (properties[k].name == "z") axes[k] = 2;
+			}
+			bool direct = format == hostFormat() && element.stride > 0 && xProperty >= 0 && xProperty + 2 < (int)properties.size();
+			for (int axis = 0; direct && axis < 3; axis++) {
+				const PlyProperty& property = properties[xProperty + axis];
+				direct = axes[xProperty + axis] == axis && property.type == PLY_FLOAT32 && property.countType == PLY_NONE;
+			}
+			if (direct) {
+				size_t stride = element.stride;
+				size_t bytes = (size_t)element.count * stride;
+				if ((size_t)(end - p) < bytes) return false;
+				if (stride == 3 * sizeof(float)) {
+					memcpy(positions, p, bytes);
+				}
+				else {
+					const char* position = p + properties[xProperty].offset;
+					for (int i = 0; i < element.count; i++) {
+						memcpy(positions + i * 3, position + i * stride, 3 * sizeof(float));
+					}
+				}
+				p += bytes;
+				continue;
+			}
+			for (int i = 0; i < element.count; i++) {
+				for (size_t k = 0; k < properties.size(); k++) {
+					double value;
+					if (axes[k] < 0 || properties[k].countType != PLY_NONE) {
+						if (!skipProperty(p, end, properties[k], format)) return false;
+					}
+					else if (readValue(p, end, properties[k].type, format, value)) {
+						positions[i * 3 + axes[k]] = (float)value;
+					}
+					else {
+						return false;
+					}
+				}
+			}
+		}
+		else if ((int)e == faceElement) {
+			int indexList = element.listProperty;
+			for (size_t k = 0; k < properties.size(); k++) {
+				if (properties[k].countType != PLY_NONE && (properties[k].name == "vertex_indices" || properties[k].name == "vertex_index")) {
+					indexList = (int)k;
+					break;
+				}
+			}
+			const PlyProperty& list = properties[indexList];
+			bool direct = format == hostFormat() && (list.type == PLY_INT32 || list.type == PLY_UINT32);
+			faceIndices.reserve((size_t)element.count * 3);
+			for (int i = 0; i < element.count; i++) {
+				for (size_t k = 0; k < properties.size(); k++) {
+					if ((int)k != indexList) {
+						if (!skipProperty(p, end, properties[k], format)) return false;
+						continue;
+					}
+					// every index takes at least a byte, a larger count can only be a broken file
+					double value;
+					if (!readValue(p, end, list.countType, format, value) || value < 0 || value > (double)(end - p)) return false;
+					int corners = (int)value;
+					size_t first = faceIndices.size();
+					faceIndices.resize(first + corners);
+					if (direct) {
+						if ((size_t)(end - p) < corners * sizeof(int)) return false;
+						if (corners > 0) memcpy(&faceIndices[first], p, corners * sizeof(int));
+						p += corners * sizeof(int);
+					}
+					else {
+						for (int j = 0; j < corners; j++) {
+							if (!readValue(p, end, list.type, format, value)) return false;
+							faceIndices[first + j] = (int)value;
+						}
+					}
+				}
+				faceStarts[i + 1] = (int)faceIndices.size();
+			}
+		}
+		else if (element.stride >= 0) {
+			size_t bytes = (size_t)element.count * element.stride;
+			if ((size_t)(end - p) < bytes) return false;
+			p += bytes;
+		}
+		else {
+			for (int i = 0; i < element.count; i++) {
+				for (size_t k = 0; k < properties.size(); k++) {
+					if (!skipProperty(p, end, properties[k], format)) return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/*  ===============================================
+Desc: Default constructor for a ply object
+Precondition:
+Postcondition:
+=============================================== */
+ply::ply() {
+	properties = 0;
+	faceCount = 0;
+	vertexCount = 0;
+}
+
+/*  ===============================================
+Desc: constructor for a ply object with a default path
+Precondition:
+Postcondition:
+=============================================== */
+ply::ply(string filePath, ThreadPool* pool) {
+	faceCount = 0;
+	vertexCount = 0;
+	properties = 0;
+	reload(filePath, pool);
+}
+
+
+/*  ===============================================
+Desc: Destructor for a ply object
+Precondition: Memory has been already allocated
+Postcondition:
+=============================================== */
+ply::~ply() {
+	reset();
+}
+
+void ply::reset() {
+	positions.clear();
+	faceStarts.clear();
+	faceIndices.clear();
+	faceCount = 0;
+	vertexCount = 0;
+}
+
+
+/*  ===============================================
+Desc: reloads the geometry for a 3D object
+Precondition:
+Postcondition:
+=============================================== */
+void ply::reload(string _filePath, ThreadPool* pool) {
+	filePath = _filePath;
+	reset();
+
+	// Call our function again to load new vertex and face information.
+	loadGeometry(pool);
+}
+
+/*  ===============================================
+Desc: Reads the file in four steps
+	1.) Map the file and parse the header
+	2.) Cut the body into chunks at line ends and count the lines of
+		each chunk, the sums give every chunk its first line number
+	3.) Parse the chunks: vertices go straight to their place in
+		positions, faces to a list per chunk
+	4.) Lay out faceStarts and copy each chunk's indices into place
+	Steps 2 to 4 run on the pool, one task per chunk. Binary bodies
+	skip them and go through readBinary.
+Precondition:
+Postcondition:
+=============================================== */
+void ply::loadGeometry(ThreadPool* pool) {
+	size_t size = 0;
+	char* data = loadFile(filePath, size);
+	if (data == NULL) {
+		cout << "cannot open file " << filePath.c_str() << "\n";
+		return;
+	}
+	PlyFormat format = PLY_ASCII;
+	vector<PlyElement> elements;
+	size_t bodyStart = 0;
+	if (!parseHeader(data, size, format, elements, bodyStart)) {
+		cout << "cannot parse the header of " << filePath.c_str() << "\n";
+		releaseFile(data, size);
+		return;
+	}
+
+	// the first line of every element in the body, the vertex and face elements by name
+	vector<long long> elementStarts(elements.size() + 1, 0);
+	int vertexElement = -1, faceElement = -1;
+	int xColumn = 0, yColumn = 1, zColumn = 2;
+	for (size_t e = 0; e < elements.size(); e++) {
+		elementStarts[e + 1] = elementStarts[e] + std::max(elements[e].count, 0);
+		const vector<PlyProperty>& properties = elements[e].properties;
+		if (elements[e].name == "vertex" && vertexElement < 0) {
+			vertexElement = (int)e;
+			for (size_t p = 0; p < properties.size(); p++) {
+				if (properties[p].name == "x") xColumn = (int)p;
+				if (properties[p].name == "y") yColumn = (int)p;
+				if (properties[p].name == "z") zColumn = (int)p;
+			}
+		}
+		if (elements[e].name == "face" && faceElement < 0 && elements[e].listProperty >= 0) {
+			faceElement = (int)e;
+		}
+	}
+	vertexCount = vertexElement >= 0 ? std::max(elements[vertexElement].count, 0) : 0;
+	faceCount = faceElement >= 0 ? std::max(elements[faceElement].count, 0) : 0;
+	properties = vertexElement >= 0 ? (int)elements[vertexElement].properties.size() : 0;
+	int columns = std::max(std::max(xColumn, yColumn), zColumn) + 1;
+	long long vertexStart = vertexElement >= 0 ? elementStarts[vertexElement] : 0;
+	long long faceStart = faceElement >= 0 ? elementStarts[faceElement] : 0;
+	int faceSkip = faceElement >= 0 ? elements[faceElement].listProperty : 0;
+	positions.assign((size_t)vertexCount * 3, 0.0f);
+	faceStarts.assign((size_t)faceCount + 1, 0);
+
+	if (format != PLY_ASCII) {
+		bool complete = readBinary(data + bodyStart, data + size, elements, format, vertexElement, faceElement, vertexCount > 0 ? &positions[0] : NULL, faceStarts, faceIndices);
+		releaseFile(data, size);
+		if (!complete) {
+			cout << "unexpected end of data in " << filePath.c_str() << "\n";
+			reset();
+			return;
+		}
+		if (vertexCount > 0) scaleAndCenter();
+		cout << "completed loading: " << filePath.c_str() << "\n";
+		return;
+	}
+
+	// chunk boundaries moved forward to just after a line end
+	const char* body = data + bodyStart;
+	const char* end = data + size;
+	size_t bodySize = size - bodyStart;
+	int chunkCount = 1;
+	if (pool != NULL) {
+		chunkCount = (int)std::max((size_t)1, std::min((size_t)pool->size() * 4, bodySize / MIN_CHUNK_BYTES));
+	}
+	vector<const char*> chunkStarts(chunkCount + 1, end);
+	chunkStarts[0] = body;
+	for (int c = 1; c < chunkCount; c++) {
+		const char* split = body + bodySize / chunkCount * c;
+		const char* lineEnd = (const char*)memchr(split, '\n', end - split);
+		chunkStarts[c] = lineEnd != NULL ? lineEnd + 1 : end;
+	}
+
+	auto runChunks = [&](const function<void(int, int)>& task) {
+		if (pool != NULL && chunkCount > 1) {
+			pool->run(chunkCount, task);
+		}
+		else {
+			for (int c = 0; c < chunkCount; c++) task(c, 0);
+		}
+	};
+
+	// a chunk's last line counts even without a line end, only the file's last one can lack it
+	vector<long long> chunkLines(chunkCount + 1, 0);
+	runChunks([&](int c, int) {
+		const char* first = chunkStarts[c];
+		const char* last = std::max(first, chunkStarts[c + 1]);
+		long long lines = std::count(first, last, '\n');
+		if (last > first && last[-1] != '\n') lines++;
+		chunkLines[c + 1] = lines;
+	});
+	for (int c = 0; c < chunkCount; c++) {
+		chunkLines[c + 1] += chunkLines[c];
+	}
+
+	vector<vector<int> > chunkIndices(chunkCount);
+	vector<int> chunkFirstFace(chunkCount, -1);
+	runChunks([&](int c, int) {
+		const char* p = chunkStarts[c];
+		const char* chunkEnd = std::max(p, chunkStarts[c + 1]);
+		vector<int>& indices = chunkIndices[c];
+		// every face takes at least "3 a b c", that's about how many indices to expect
+		indices.reserve((chunkEnd - p) / 4);
+		// the parsers stop at line ends, what a line has left over is skipped afterwards
+		for (long long line = chunkLines[c]; p < chunkEnd; line++) {
+			const char* q = p;
+			if (line >= vertexStart && line < vertexStart + vertexCount) {
+				float* position = &positions[(line - vertexStart) * 3];
+				for (int column = 0; column < columns; column++) {
+					float value = 0.0f;
+					if (!parseFloat(q, chunkEnd, value)) break;
+					if (column == xColumn) position[0] = value;
+					if (column == yColumn) position[1] = value;
+					if (column == zColumn) position[2] = value;
+				}
+			}
+			else if (line >= faceStart && line < faceStart + faceCount) {
+				int face = (int)(line - faceStart);
+				if (chunkFirstFace[c] < 0) chunkFirstFace[c] = face;
+				// scalar properties in front of the index list
+				float skipped;
+				for (int column = 0; column < faceSkip; column++) {
+					parseFloat(q, chunkEnd, skipped);
+				}
+				int count = 0, index;
+				parseInt(q, chunkEnd, count);
+				int read = 0;
+				for (; read < count && parseInt(q, chunkEnd, index); read++) {
+					indices.push_back(index);
+				}
+				faceStarts[face + 1] = read;
+			}
+			while (q < chunkEnd && *q != '\n') q++;
+			p = q + 1;
+		}
+	});
+
+	// face sizes to offsets, then each chunk's indices go to where its first face starts
+	for (int i = 0; i < faceCount; i++) {
+		faceStarts[i + 1] += faceStarts[i];
+	}
+	faceIndices.resize(faceCount > 0 ? faceStarts[faceCount] : 0);
+	runChunks([&](int c, int) {
+		if (chunkFirstFace[c] >= 0 && !chunkIndices[c].empty()) {
+			memcpy(&faceIndices[faceStarts[chunkFirstFace[c]]], &chunkIndices[c][0], chunkIndices[c].size() * sizeof(int));
+		}
+	});
+
+	releaseFile(data, size);
+	if (vertexCount > 0) scaleAndCenter();
+	cout << "completed loading: " << filePath.c_str() << "\n";
+}
+
+/*  ===============================================
+Desc: Moves all the geometry so that the object is centered at 0, 0, 0 and scaled to be between 0.5 and -0.5
+Precondition: after all the vetices and faces have been loaded in
+Postcondition:
+=============================================== */
+void ply::scaleAndCenter() {
+	float avrg_x = 0.0;
+	float avrg_y = 0.0;
+	float avrg_z = 0.0;
+	float max = 0.0;
+	int   i;
+	float* vertex = &positions[0];
+
+	// loop through each vertex in the given image
+	for (i = 0; i < vertexCount; i++) {
+
+		// obtain the total for each property of the vertex
+		avrg_x += vertex[i * 3];
+		avrg_y += vertex[i * 3 + 1];
+		avrg_z += vertex[i * 3 + 2];
+	}
+
+	// compute the average for each property
+	avrg_x = avrg_x / vertexCount;
+	avrg_y = avrg_y / vertexCount;
+	avrg_z = avrg_z / vertexCount;
+
+	// center each vertex
+	for (i = 0; i < vertexCount; i++) {
+		vertex[i * 3] = (vertex[i * 3] - avrg_x);
+		vertex[i * 3 + 1] = (vertex[i * 3 + 1] - avrg_y);
+		vertex[i * 3 + 2] = (vertex[i * 3 + 2] - avrg_z);
+	}
+
+	// find the range of the vertices
+	for (i = 0; i < vertexCount * 3; i++) {
+		// obtain the max dimension to find the furthest point from 0,0
+		if (max < fabs(vertex[i])) max = fabs(vertex[i]);
+	}
+
+	// max is doubled so that the range we get is from 0.5 to -0.5
+	max *= 2.0f;
+
+	// scale each vertex to fit within the bounds
+	for (i = 0; i < vertexCount * 3; i++) {
+		vertex[i] = vertex[i] / max;
+	}
+}
+
+/*  ===============================================
+Desc: Prints some statistics about the file you have read in
+This is useful for debugging information to see if we parse our file correctly.
+
+Precondition:
+Postcondition:
+=============================================== */
+void ply::printAttributes() {
+	cout << "==== ply Mesh Attributes=====" << endl;
+	cout << "vertex count:" << vertexCount << endl;
+	cout << "face count:" << faceCount << endl;
+	cout << "properties:" << properties << endl;
+}
+
+/*  ===============================================
+Desc: Iterate through our array and print out each vertex.
+
+Precondition:
+Postcondition:
+=============================================== */
+void ply::printVertexList() {
+	for (int i = 0; i < vertexCount; i++) {
+		cout << positions[i * 3] << "," << positions[i * 3 + 1] << "," << positions[i * 3 + 2] << endl;
+	}
+}
+
+/*  ===============================================
+Desc: Iterate through our array and print out each face.
+
+Precondition:
+Postcondition:
+=============================================== */
+void ply::printFaceList() {
+	// For each of our faces
+	for (int i = 0; i < faceCount; i++) {
+		// Get the vertices that make up each face from the face list
+		for (int j = faceStarts[i]; j < faceStarts[i + 1]; j++) {
+			// Print out the vertex
+			int index = faceIndices[j];
+			if (index < 0 || index >= vertexCount) continue;
+			cout << positions[index * 3] << "," << positions[index * 3 + 1] << "," << positions[index * 3 + 2] << endl;
+		}
+	}
+}
@@ -0,0 +1,110 @@
+/*  =================== File Information =================
+	File Name: ply.h
+	Description:
+	Author: Michael Shah
+
+	Purpose:	Specification for using
+	Examples:	See example below for using PLY class
+
+	The ray tracer's copy of the a3 loader: it only parses the file, the
+	OpenGL vertex buffers are left out so a4 still builds without OpenGL.
+	Positions and faces go straight into flat arrays, and the body of a
+	large ASCII file is parsed in chunks on a thread pool. Binary files
+	(either byte order) are read in one pass.
+	===================================================== */
+#ifndef PLY_H
+#define PLY_H
+
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+using namespace std;
+
+/*  ============== ply ==============
+	Purpose: Load a PLY File
+
+	Note that the ply file inherits from a base class called 'entity'
+	This class stores common transformations that can be applied to 3D entities(such as mesh files, lights, or cameras)
+
+	Example usage:
+
+	1.) ply* myPLY = new ply (filenamePath);
+	2.) read myPLY->getPositions() / getFaceStarts() / getFaceIndices()
+	3.) delete myPLY;
+
+	==================================== */
+class ply {
+
+public:
+	ply();
+	// pool parses the body of large files in parallel, NULL keeps it on this thread
+	ply(string filePath, ThreadPool* pool = NULL);
+	~ply();
+	void reset();
+
+	/*	===============================================
+		Desc: reloads the geometry for a 3D object
+	=============================================== */
+	void reload(string _filePath, ThreadPool* pool = NULL);
+
+	/*	===============================================
+		Desc: The loaded geometry, scaled and centered to fit
+		between -0.5 and 0.5. Empty if the file could not be read.
+		getPositions() holds x, y and z of every vertex. Face i
+		uses the vertex indices getFaceIndices()[getFaceStarts()[i]]
+		up to getFaceStarts()[i + 1], so there are faceCount + 1 starts.
+	=============================================== */
+	int getVertexCount() const { return vertexCount; }
+	int getFaceCount() const { return faceCount; }
+	const float* getPositions() const { return positions.empty() ? NULL : &positions[0]; }
+	const int* getFaceStarts() const { return faceStarts.empty() ? NULL : &faceStarts[0]; }
+	const int* getFaceIndices() const { return faceIndices.empty() ? NULL : &faceIndices[0]; }
+
+	/*	===============================================
+		Desc: Prints some statistics about the file you have read in
+	=============================================== */
+	void printAttributes();
+
+	/*  ===============================================
+		Desc: Helper function for you to debug if
+		you are reading in the correct data.
+		(Generally these would not be public functions,
+		they are here to help you understand the interface)
+		=============================================== */
+	void printVertexList();
+	void printFaceList();
+
+private:
+	/*	===============================================
+		Desc: Helper function used in the constructor
+		=============================================== */
+	void loadGeometry(ThreadPool* pool);
+	void scaleAndCenter();
+
+	/*	===============================================
+		Header Data
+
+		These variables are useful to store information
+		about the mesh we are loading.  Often these values
+		are stored in the header, or can be useful for
+		debugging.
+		=============================================== */
+		// Store the path to our file
+	string filePath;
+	// Stores the number of vertics loaded
+	int vertexCount;
+	// Stores the number of faces loaded
+	int faceCount;
+	// Tells us how many properites a vertex has in the file
+	int properties;
+	// x, y, z of every vertex, the other vertex properties are skipped
+	vector<float> positions;
+	// where each face's indices begin in faceIndices, plus the end of the last face
+	vector<int> faceStarts;
+	// the vertex indices of all faces one after the other
+	vector<int> faceIndices;
+};
+
+#endif
\ No newline at end of file
@@ -77,6 +77,11 @@ class ppm{
 									// color[4] = second g value
 									// color[5] = second b value
 									// etc.
+									// A P6 file is mapped into memory and color points
+									// straight at its pixels instead.
+		char* fileData;				// the mapped file, kept while color points into it
+		size_t fileSize;
+		void releaseFile();
 
 		
 };
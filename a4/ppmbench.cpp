@@ -0,0 +1,169 @@
+/*  =================== File Information =================
+	File Name: ppmbench.cpp
+	Description:
+	Author:
+
+	Purpose: Micro-benchmark for the ppm loader. Writes a generated image as an
+	         ASCII P3 file (one value per line, the way GIMP and converter.py
+	         write them) and as a binary P6 file, then times the line by line
+	         getline/strtok/atoi parser ppm.cpp used to have against the
+	         scanner that replaced it, and against mapping the P6 file. The P6
+	         time includes a pass over every pixel, since mapped pages are
+	         only read when they are touched. All three must load the same
+	         bytes.
+	Usage:	a4-ppmbench [width height (default 4096 2048)] [repeats (default 3)]
+	===================================================== */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+#include "ppm.h"
+
+using namespace std;
+
+static const char* P3_FILE = "ppmbench_p3.ppm";
+static const char* P6_FILE = "ppmbench_p6.ppm";
+
+static double seconds(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// smooth gradients with some noise, so values have one to three digits like a photo
+static vector<unsigned char> makeImage(int width, int height) {
+	vector<unsigned char> pixels((size_t)width * height * 3);
+	unsigned int state = 12345;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			state = state * 1664525u + 1013904223u;
+			unsigned char* pixel = &pixels[((size_t)y * width + x) * 3];
+			pixel[0] = (unsigned char)(x * 255 / width);
+			pixel[1] = (unsigned char)(y * 255 / height);
+			pixel[2] = (unsigned char)(state >> 24);
+		}
+	}
+	return pixels;
+}
+
+static bool writeFiles(const vector<unsigned char>& pixels, int width, int height) {
+	FILE* p3 = fopen(P3_FILE, "w");
+	FILE* p6 = fopen(P6_FILE, "wb");
+	if (p3 == NULL || p6 == NULL) {
+		printf("Unable to write the test images\n");
+		if (p3 != NULL) fclose(p3);
+		if (p6 != NULL) fclose(p6);
+		return false;
+	}
+	fprintf(p3, "P3\n# CREATOR: a4-ppmbench\n%d %d\n255\n", width, height);
+	for (size_t i = 0; i < pixels.size(); i++) {
+		fprintf(p3, "%d\n", pixels[i]);
+	}
+	fprintf(p6, "P6\n# CREATOR: a4-ppmbench\n%d %d\n255\n", width, height);
+	fwrite(&pixels[0], 1, pixels.size(), p6);
+	fclose(p3);
+	fclose(p6);
+	return true;
+}
+
+// the loop ppm::ppm ran before, kept as the baseline. Expects the comment on line 2
+static vector<char> legacyLoad(const char* fileName, int& width, int& height) {
+	vector<char> color;
+	width = height = 0;
+	ifstream ppmFile(fileName);
+	string line;
+	int iteration = 0;
+	int pos = 0;
+	while (getline(ppmFile, line)) {
+		char* copy = new char[line.length() + 1];
+		strcpy(copy, line.c_str());
+		char* token = strtok(copy, " ");
+		if (iteration == 2) {
+			width = atoi(token);
+			token = strtok(NULL, " ");
+			height = atoi(token);
+			color.resize((size_t)width * height * 3);
+		}
+		else if (iteration > 3) {
+			while (token != NULL) {
+				color[pos++] = (char)atoi(token);
+				token = strtok(NULL, " ");
+			}
+		}
+		delete[] copy;
+		iteration++;
+	}
+	return color;
+}
+
+// sums every byte so a lazily mapped image is really read
+static unsigned int touch(const char* pixels, size_t count) {
+	unsigned int sum = 0;
+	for (size_t i = 0; i < count; i++) {
+		sum += (unsigned char)pixels[i];
+	}
+	return sum;
+}
+
+int main(int argc, char **argv) {
+	int width = 4096;
+	int height = 2048;
+	int repeats = 3;
+	if (argc >= 3) {
+		width = atoi(argv[1]);
+		height = atoi(argv[2]);
+	}
+	if (argc >= 4) repeats = atoi(argv[3]);
+	if (argc == 2 || width <= 0 || height <= 0 || repeats <= 0) {
+		printf("usage: %s [width height] [repeats]\n", argv[0]);
+		return 1;
+	}
+
+	vector<unsigned char> pixels = makeImage(width, height);
+	if (!writeFiles(pixels, width, height)) return 1;
+	size_t count = pixels.size();
+	ifstream p3Size(P3_FILE, ios::binary | ios::ate);
+	double p3Megabytes = (double)p3Size.tellg() / (1024.0 * 1024.0);
+	printf("%d x %d image, P3 %.1f MB, P6 %.1f MB, best of %d\n", width, height, p3Megabytes, count / (1024.0 * 1024.0), repeats);
+
+	// ppm logs every load to cout, without a buffer cout drops it
+	streambuf* coutBuffer = cout.rdbuf(NULL);
+	double legacyBest = 1e30, scanBest = 1e30, mappedBest = 1e30;
+	bool same = true;
+	unsigned int expected = touch((const char*)&pixels[0], count);
+	for (int r = 0; r < repeats; r++) {
+		auto start = chrono::steady_clock::now();
+		int legacyWidth, legacyHeight;
+		vector<char> legacy = legacyLoad(P3_FILE, legacyWidth, legacyHeight);
+		legacyBest = min(legacyBest, seconds(start));
+		same = same && legacy.size() == count && memcmp(&legacy[0], &pixels[0], count) == 0;
+
+		start = chrono::steady_clock::now();
+		{
+			ppm image(P3_FILE);
+			scanBest = min(scanBest, seconds(start));
+			same = same && image.getWidth() == width && image.getHeight() == height && memcmp(image.getPixels(), &pixels[0], count) == 0;
+		}
+
+		start = chrono::steady_clock::now();
+		{
+			ppm image(P6_FILE);
+			unsigned int sum = image.getPixels() != NULL ? touch(image.getPixels(), count) : 0;
+			mappedBest = min(mappedBest, seconds(start));
+			same = same && sum == expected && memcmp(image.getPixels(), &pixels[0], count) == 0;
+		}
+	}
+	cout.rdbuf(coutBuffer);
+
+	printf("  P3 getline/strtok %10.1f ms\n", legacyBest * 1000.0);
+	printf("  P3 scanner        %10.1f ms  (%.1fx)\n", scanBest * 1000.0, legacyBest / scanBest);
+	printf("  P6 mapped         %10.1f ms  (%.1fx)\n", mappedBest * 1000.0, legacyBest / mappedBest);
+	printf("  %s\n", same ? "all loaders read the same pixels" : "MISMATCH between the loaders");
+	remove(P3_FILE);
+	remove(P6_FILE);
+	return same ? 0 : 2;
+}
@@ -145,6 +145,8 @@ public:
    OBJ_TYPE type;
    string meshfile;     //! Only applicable to meshes
    SceneMaterial material;
+
+   bool dirty = false;  //! Material edited since the scene was last compiled
 };
 
 /*!
@@ -188,6 +190,9 @@ public:
 
    /*! Children of this node */
    std::vector<SceneNode*> children;
+
+   /*! Transformations edited since the scene was last flattened */
+   bool dirty = false;
 };
 
 #endif
@@ -127,6 +127,8 @@ bool SceneParser::parse()
       m_cameraData.look = glm::vec3(-1, -1, -1);
       m_cameraData.heightAngle = 45;
       m_cameraData.aspectRatio = 1.0f;
+      m_cameraData.aperture = 0;
+      m_cameraData.focalLength = 0;
 
       /* Default global data */
       m_globalData.ka = 0.5f;
@@ -9,11 +9,92 @@
 	===================================================== */
 
 #include <FL/gl.h>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
 #include <iostream>
 #include <string>
 #include <fstream>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #include "ppm.h"
 
+// the first value after pos in the header, skipping whitespace and # comments. -1 if there is none
+static int headerValue(const char* data, size_t size, size_t& pos) {
+	while (pos < size) {
+		if (data[pos] == '#') {
+			while (pos < size && data[pos] != '\n') pos++;
+		}
+		else if (isspace((unsigned char)data[pos])) {
+			pos++;
+		}
+		else {
+			break;
+		}
+	}
+	if (pos >= size || !isdigit((unsigned char)data[pos])) return -1;
+	int value = 0;
+	for (; pos < size && isdigit((unsigned char)data[pos]); pos++) {
+		if (value > 100000000) return -1;
+		value = value * 10 + (data[pos] - '0');
+	}
+	return value;
+}
+
+/*	Reads up to count decimal values of a P3 body into out and returns how many it found.
+	There is no branch on the characters: each one either extends the value or ends it,
+	the value is stored every step and the write position only moves past a finished one,
+	so lines, spaces and tabs all cost the same. */
+static size_t scanValues(const char* data, size_t size, size_t pos, char* out, size_t count) {
+	size_t written = 0;
+	unsigned int value = 0;
+	unsigned int inValue = 0;
+	for (; pos < size && written < count; pos++) {
+		unsigned int digit = (unsigned char)data[pos] - '0';
+		unsigned int isDigit = digit < 10;
+		out[written] = (char)value;
+		written += inValue & (isDigit ^ 1);
+		value = (value * 10 + digit) & (0u - isDigit);
+		inValue = isDigit;
+	}
+	// the last value can run up to the end of the file
+	if (inValue && written < count) out[written++] = (char)value;
+	return written;
+}
+
+/*	The whole file in memory. Where mmap exists the file is mapped copy on write: pages
+	are read as they are touched and setPixel never writes through to the file.
+	Elsewhere it is read into a new[] buffer. NULL if the file can't be read. */
+static char* loadFile(const std::string& fileName, size_t& size) {
+#ifdef _WIN32
+	std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return NULL;
+	size = (size_t)file.tellg();
+	if (size == 0) return NULL;
+	char* data = new char[size];
+	file.seekg(0);
+	file.read(data, size);
+	return data;
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) return NULL;
+	char* data = NULL;
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size > 0) {
+		size = (size_t)info.st_size;
+		void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED) data = (char*)mapping;
+	}
+	// the mapping outlives the descriptor
+	close(fd);
+	return data;
+#endif
+}
+
 /*	===============================================
 Desc:	Default constructor for a ppm
 Precondition: _fileName is the image file name. It is also expected that the file is of type "ppm"
@@ -24,83 +105,82 @@ Postcondition: The array 'color' is allocated memory according to the image dime
 ppm::ppm(std::string _fileName){
 	textureID = -1;
   /* Algorithm
-      Step 1: Parse header of PPM
-      Step 2: Read in colors into array
-      Step 3: Allocate memory for width and height dimensions
+      Step 1: Map the file into memory
+      Step 2: Parse the header, comments may sit between any of its values
+      Step 3: Use P6 pixels where they are, scan P3 values into a new array
   */
+  // stay an empty image if the file can't be read
+  width = 0;
+  height = 0;
+  color = NULL;
+  fileData = NULL;
+  fileSize = 0;
 
+  fileData = loadFile(_fileName, fileSize);
+  if (fileData == NULL) {
+	  std::cout << "Unable to open ppm file: " << _fileName << std::endl;
+	  return;
+  }
+  std::cout << "Reading in ppm file: " << _fileName << std::endl;
 
-  // Open an input file stream for reading a file
-  std::ifstream ppmFile(_fileName.c_str());
-  // If our file successfully opens, begin to process it.
-  if (ppmFile.is_open()) {
-	  // line will store one line of input
-	  std::string line;
-	  // Our loop invariant is to continue reading input until
-	  // we reach the end of the file and it reads in a NULL character
-	  std::cout << "Reading in ppm file: " << _fileName << std::endl;
-	  // Our delimeter pointer which is used to store a single token in a given
-	  // string split up by some delimeter(s) specified in the strtok function
-	  char* delimeter_pointer;
-	  int iteration = 0;
-	  int pos = 0;
-	  while (getline(ppmFile, line)) {
-		  char* copy = new char[line.length() + 1];
-		  strcpy(copy, line.c_str());
-		  delimeter_pointer = strtok(copy, " ");
-
-		  if (copy[0] == '#') {
-			  continue;
-		  }
-
-		  // Read in the magic number
-		  if (iteration == 0) {
-			  magicNumber = delimeter_pointer;
-			  std::cout << "Magic Number: " << magicNumber << std::endl;
-			  if (magicNumber.compare("P3") != 0) {
-				  std::cout <<  "Incorrect image file format.Cannot load texutre" << std::endl;
-				  break;
-			  }
-		  }
-		  // Read in dimensions
-		  else if (iteration == 1) {
-			  width = atoi(delimeter_pointer);
-			  std::cout << "width: " << width << " ";
-			  delimeter_pointer = strtok(NULL, " ");
-			  height = atoi(delimeter_pointer);
-			  std::cout << "height: " << height << std::endl;
-			  // Allocate memory for the color array
-			  if (width > 0 && height > 0) {
-				  color = new char[width*height * 3];
-				  if (color == NULL) {
-					  std::cout << "Unable to allocate memory for ppm" << std::endl;
-					  break;
-				  }
-			  }
-			  else {
-				  std::cout << "PPM not parsed correctly, width and height dimensions are 0" << std::endl;
-				  break;
-			  }
-		  }
-		  else if (iteration == 2) {
-			  std::cout << "color range: 0-" << delimeter_pointer << std::endl;
-
-			  int num = width * height * 3;
-			  for (int i = 0; i < num; i++) {
-				  int value;
-				  ppmFile >> value;
-                  //std::cout << i << ": " << value << std::endl;
-				  color[i] = value;
-			  }
-		  }
-		  delete [] copy;
-		  iteration++;
+  size_t pos = 2;
+  if (fileSize >= 2) magicNumber = std::string(fileData, 2);
+  std::cout << "Magic Number: " << magicNumber << std::endl;
+  bool binary = magicNumber == "P6";
+  if (!binary && magicNumber != "P3") {
+	  std::cout << "Incorrect image file format, only P3 and P6 can be read" << std::endl;
+	  releaseFile();
+	  return;
+  }
+
+  int imageWidth = headerValue(fileData, fileSize, pos);
+  int imageHeight = headerValue(fileData, fileSize, pos);
+  int maxValue = headerValue(fileData, fileSize, pos);
+  std::cout << "width: " << imageWidth << " height: " << imageHeight << std::endl;
+  if (imageWidth <= 0 || imageHeight <= 0 || maxValue <= 0) {
+	  std::cout << "PPM not parsed correctly, width and height dimensions are 0" << std::endl;
+	  releaseFile();
+	  return;
+  }
+  std::cout << "color range: 0-" << maxValue << std::endl;
+
+  size_t count = (size_t)imageWidth * imageHeight * 3;
+  if (binary) {
+	  // one whitespace character ends the header, the rest is laid out exactly like color
+	  pos++;
+	  if (maxValue > 255 || pos > fileSize || fileSize - pos < count) {
+		  std::cout << "P6 file is cut short or has 16 bit colors" << std::endl;
+		  releaseFile();
+		  return;
 	  }
-	  ppmFile.close();
+	  color = fileData + pos;
   }
-  else{
-      std::cout << "Unable to open ppm file: " << _fileName << std::endl;
-  } 
+  else {
+	  // every value takes at least a digit, a larger image means a broken header
+	  if (pos > fileSize || count > fileSize - pos) {
+		  std::cout << "P3 file is cut short" << std::endl;
+		  releaseFile();
+		  return;
+	  }
+	  // values missing at the end stay black
+	  color = new char[count]();
+	  scanValues(fileData, fileSize, pos, color, count);
+	  releaseFile();
+  }
+  width = imageWidth;
+  height = imageHeight;
+}
+
+// unmaps (or frees) the file, color must not point into it anymore
+void ppm::releaseFile() {
+	if (fileData == NULL) return;
+#ifdef _WIN32
+	delete[] fileData;
+#else
+	munmap(fileData, fileSize);
+#endif
+	fileData = NULL;
+	fileSize = 0;
 }
 
 
@@ -114,11 +194,15 @@ ppm::~ppm(){
 	if (textureID != -1) {
 		glDeleteTextures(1, &textureID);
 	}
-	
-	if (color!=NULL){
-		delete[] color;
-		color=NULL;
-	}	
+
+  // P6 pixels live in the mapped file
+  if (fileData != NULL) {
+    releaseFile();
+  }
+  else if (color != NULL) {
+    delete[] color;
+  }
+  color = NULL;
 }
 
 /*  ===============================================
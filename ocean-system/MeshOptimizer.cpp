@@ -0,0 +1,283 @@
+#include "MeshOptimizer.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+// Forsyth's constants from "Linear-Speed Vertex Cache Optimisation"
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+// live triangle counts the valence scores are tabled for, busier vertices are computed
+static const int VALENCE_TABLE_SIZE = 64;
+
+static const unsigned int UNUSED = ~0u;
+
+const int MeshOptimizer::SIMULATED_CACHE_SIZE;
+const int MeshOptimizer::SCORING_CACHE_SIZE;
+
+/*	A FIFO cache that remembers when every vertex went in instead of keeping the
+	entries: a vertex is still cached while fewer than size vertices came in after
+	it. Emptying it only moves the clock on, so it is cheap to do per cluster. */
+struct FifoCache {
+	vector<int> entered;
+	int time;
+	int size;
+
+	FifoCache(int vertexCount, int cacheSize) : entered(vertexCount, 0), time(0), size(cacheSize) {
+	}
+
+	// true when v had to be transformed
+	bool miss(unsigned int v) {
+		if (entered[v] != 0 && time - entered[v] < size) return false;
+		entered[v] = ++time;
+		return true;
+	}
+
+	int triangleMisses(const unsigned int* triangle) {
+		return miss(triangle[0]) + miss(triangle[1]) + miss(triangle[2]);
+	}
+
+	void flush() {
+		time += size;
+	}
+};
+
+MeshOptimizer::CacheStats MeshOptimizer::simulateCache(const unsigned int* indices, int indexCount, int vertexCount, int cacheSize) {
+	CacheStats stats;
+	stats.transformed = 0;
+	stats.acmr = 0.0f;
+	stats.atvr = 0.0f;
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0) return stats;
+
+	FifoCache cache(vertexCount, cacheSize);
+	vector<bool> used(vertexCount, false);
+	int usedCount = 0;
+	for (int i = 0; i < triangleCount * 3; i++) {
+		if (!used[indices[i]]) {
+			used[indices[i]] = true;
+			usedCount++;
+		}
+		stats.transformed += cache.miss(indices[i]);
+	}
+	stats.acmr = (float)stats.transformed / triangleCount;
+	stats.atvr = (float)stats.transformed / usedCount;
+	return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(unsigned int* indices, int indexCount, int vertexCount) {
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0) return;
+
+	// the triangles around every vertex, the ones not drawn yet are kept at the front of its range
+	vector<int> live(vertexCount, 0);
+	for (int i = 0; i < triangleCount * 3; i++) live[indices[i]]++;
+	vector<int> firstTriangle(vertexCount + 1, 0);
+	for (int v = 0; v < vertexCount; v++) firstTriangle[v + 1] = firstTriangle[v] + live[v];
+	vector<int> adjacency(triangleCount * 3);
+	vector<int> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (int t = 0; t < triangleCount; t++) {
+		for (int k = 0; k < 3; k++) adjacency[filled[indices[t * 3 + k]]++] = t;
+	}
+
+	float cacheScores[SCORING_CACHE_SIZE];
+	for (int i = 0; i < SCORING_CACHE_SIZE; i++) {
+		// the last triangle's vertices get a fixed score so the same triangle doesn't win again
+		if (i < 3) cacheScores[i] = LAST_TRIANGLE_SCORE;
+		else cacheScores[i] = pow(1.0f - (float)(i - 3) / (SCORING_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+	}
+	float valenceScores[VALENCE_TABLE_SIZE];
+	for (int i = 1; i < VALENCE_TABLE_SIZE; i++) valenceScores[i] = VALENCE_BOOST_SCALE * pow((float)i, -VALENCE_BOOST_POWER);
+	// vertices with few triangles left are boosted, finishing them closes up the drawn region
+	auto score = [&](int position, int liveCount) {
+		if (liveCount == 0) return -1.0f;
+		float s = position >= 0 ? cacheScores[position] : 0.0f;
+		if (liveCount < VALENCE_TABLE_SIZE) return s + valenceScores[liveCount];
+		return s + VALENCE_BOOST_SCALE * pow((float)liveCount, -VALENCE_BOOST_POWER);
+	};
+
+	vector<float> vertexScores(vertexCount);
+	for (int v = 0; v < vertexCount; v++) vertexScores[v] = score(-1, live[v]);
+	vector<float> triangleScores(triangleCount);
+	int best = 0;
+	for (int t = 0; t < triangleCount; t++) {
+		const unsigned int* triangle = indices + t * 3;
+		triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+		if (triangleScores[t] > triangleScores[best]) best = t;
+	}
+
+	vector<bool> emitted(triangleCount, false);
+	vector<unsigned int> output(triangleCount * 3);
+	// LRU order, the three extra slots hold the vertices pushed out by the newest triangle
+	unsigned int cache[SCORING_CACHE_SIZE + 3];
+	unsigned int newCache[SCORING_CACHE_SIZE + 3];
+	int cacheSize = 0;
+	// the next triangle in file order, taken when nothing in the cache has triangles left
+	int cursor = 0;
+
+	for (int drawn = 0; drawn < triangleCount; drawn++) {
+		if (best < 0) {
+			while (emitted[cursor]) cursor++;
+			best = cursor;
+		}
+		const unsigned int* triangle = indices + best * 3;
+		memcpy(&output[drawn * 3], triangle, 3 * sizeof(unsigned int));
+		emitted[best] = true;
+
+		int newSize = 0;
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = triangle[k];
+			// a degenerate triangle lists a vertex twice, it is in its range twice as well
+			int* first = &adjacency[firstTriangle[v]];
+			int* found = find(first, first + live[v], best);
+			swap(*found, first[live[v] - 1]);
+			live[v]--;
+			if (find(newCache, newCache + newSize, v) == newCache + newSize) newCache[newSize++] = v;
+		}
+		for (int i = 0; i < cacheSize; i++) {
+			unsigned int v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2]) newCache[newSize++] = v;
+		}
+
+		// every vertex in the cache moved, so its score and those of its live triangles change
+		for (int i = 0; i < newSize; i++) {
+			unsigned int v = newCache[i];
+			float updated = score(i < SCORING_CACHE_SIZE ? i : -1, live[v]);
+			float delta = updated - vertexScores[v];
+			vertexScores[v] = updated;
+			const int* first = &adjacency[firstTriangle[v]];
+			for (int j = 0; j < live[v]; j++) triangleScores[first[j]] += delta;
+		}
+
+		best = -1;
+		float bestScore = 0.0f;
+		cacheSize = min(newSize, SCORING_CACHE_SIZE);
+		for (int i = 0; i < cacheSize; i++) {
+			unsigned int v = newCache[i];
+			cache[i] = v;
+			const int* first = &adjacency[firstTriangle[v]];
+			for (int j = 0; j < live[v]; j++) {
+				if (best < 0 || triangleScores[first[j]] > bestScore) {
+					best = first[j];
+					bestScore = triangleScores[best];
+				}
+			}
+		}
+	}
+	memcpy(indices, &output[0], triangleCount * 3 * sizeof(unsigned int));
+}
+
+void MeshOptimizer::optimizeOverdraw(unsigned int* indices, int indexCount, const float* positions, int vertexCount, float threshold) {
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0) return;
+
+	// the cache order starts over wherever a triangle misses with all three vertices
+	vector<int> hardStarts;
+	FifoCache cache(vertexCount, SIMULATED_CACHE_SIZE);
+	for (int t = 0; t < triangleCount; t++) {
+		if (cache.triangleMisses(indices + t * 3) == 3 || t == 0) hardStarts.push_back(t);
+	}
+	hardStarts.push_back(triangleCount);
+
+	/*	Each of those is split further as soon as the triangles since the last split,
+		drawn from an empty cache, miss no more often than threshold times the
+		whole cluster does. Smaller clusters sort better, but every split empties
+		the cache, so splits are only made where the cluster has paid for it. */
+	vector<int> clusterStarts;
+	for (size_t c = 0; c + 1 < hardStarts.size(); c++) {
+		int start = hardStarts[c];
+		int end = hardStarts[c + 1];
+		cache.flush();
+		int misses = 0;
+		for (int t = start; t < end; t++) misses += cache.triangleMisses(indices + t * 3);
+		float clusterMissRatio = (float)misses / (end - start);
+
+		cache.flush();
+		misses = 0;
+		int softStart = start;
+		clusterStarts.push_back(start);
+		for (int t = start; t < end - 1; t++) {
+			misses += cache.triangleMisses(indices + t * 3);
+			if ((float)misses / (t + 1 - softStart) <= threshold * clusterMissRatio) {
+				softStart = t + 1;
+				clusterStarts.push_back(softStart);
+				cache.flush();
+				misses = 0;
+			}
+		}
+	}
+	int clusterCount = (int)clusterStarts.size();
+	clusterStarts.push_back(triangleCount);
+
+	// area weighted centroid and normal of every cluster and the centroid of the mesh
+	vector<float> clusterData(clusterCount * 7, 0.0f);
+	float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+	for (int c = 0; c < clusterCount; c++) {
+		float* data = &clusterData[c * 7];
+		for (int t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+			const float* p0 = positions + indices[t * 3] * 3;
+			const float* p1 = positions + indices[t * 3 + 1] * 3;
+			const float* p2 = positions + indices[t * 3 + 2] * 3;
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (int k = 0; k < 3; k++) {
+				data[k] += (p0[k] + p1[k] + p2[k]) / 3.0f * area;
+				data[3 + k] += n[k];
+			}
+			data[6] += area;
+		}
+		for (int k = 0; k < 3; k++) meshCentroid[k] += data[k];
+		meshArea += data[6];
+	}
+	if (meshArea > 0.0f) {
+		for (int k = 0; k < 3; k++) meshCentroid[k] /= meshArea;
+	}
+
+	// clusters that face away from the middle are drawn first, they tend to hide the rest
+	vector<float> keys(clusterCount, 0.0f);
+	for (int c = 0; c < clusterCount; c++) {
+		const float* data = &clusterData[c * 7];
+		float length = sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+		if (data[6] <= 0.0f || length <= 0.0f) continue;
+		for (int k = 0; k < 3; k++) keys[c] += (data[k] / data[6] - meshCentroid[k]) * data[3 + k] / length;
+	}
+	vector<int> order(clusterCount);
+	for (int c = 0; c < clusterCount; c++) order[c] = c;
+	stable_sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] > keys[b]; });
+
+	vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+	for (int i = 0; i < clusterCount; i++) {
+		int c = order[i];
+		output.insert(output.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+	}
+	memcpy(indices, &output[0], triangleCount * 3 * sizeof(unsigned int));
+}
+
+void MeshOptimizer::optimizeVertexFetch(unsigned int* indices, int indexCount, int vertexCount, float* positions, float* normals, vector<unsigned int>& remap) {
+	remap.assign(vertexCount, UNUSED);
+	unsigned int next = 0;
+	for (int i = 0; i < indexCount; i++) {
+		unsigned int& v = indices[i];
+		if (remap[v] == UNUSED) remap[v] = next++;
+		v = remap[v];
+	}
+	for (int v = 0; v < vertexCount; v++) {
+		if (remap[v] == UNUSED) remap[v] = next++;
+	}
+
+	float* arrays[2] = { positions, normals };
+	vector<float> copy;
+	for (int a = 0; a < 2; a++) {
+		if (arrays[a] == NULL) continue;
+		copy.assign(arrays[a], arrays[a] + vertexCount * 3);
+		for (int v = 0; v < vertexCount; v++) memcpy(arrays[a] + remap[v] * 3, &copy[v * 3], 3 * sizeof(float));
+	}
+}